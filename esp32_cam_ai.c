@@ -1,308 +1,316 @@
-#include <furi.h>
-#include <furi_hal.h>
-#include <gui/gui.h>
-#include <gui/view_dispatcher.h>
-#include <gui/scene_manager.h>
-#include <gui/modules/submenu.h>
-#include <gui/modules/text_box.h>
-#include <gui/modules/popup.h>
+#include "esp32_cam_ai_i.h"
+
+#include <gui/elements.h>
 #include <gui/modules/dialog_ex.h>
-#include <gui/modules/variable_item_list.h>
-#include <gui/modules/text_input.h>
-#include <notification/notification_messages.h>
 #include <expansion/expansion.h>
 
-#define TAG "ESP32CamAI"
-
-// UART Configuration matching ESP32-CAM firmware
-#define UART_CH (FuriHalSerialIdUsart)
-#define BAUDRATE (115200)
-
-// Application scenes
-typedef enum {
-    ESP32CamAISceneStart,
-    ESP32CamAISceneMenu,
-    ESP32CamAISceneResponse,
-    ESP32CamAIScenePTT,
-    ESP32CamAISceneSettings,
-    ESP32CamAISceneCustomVision,     // NUOVO
-    ESP32CamAISceneCustomChat,       // NUOVO
-    ESP32CamAISceneTextInput,        // NUOVO
-    ESP32CamAISceneCount,
-} ESP32CamAIScene;
-
-// Application views  
-typedef enum {
-    ESP32CamAIViewSubmenu,
-    ESP32CamAIViewResponse,
-    ESP32CamAIViewPTT,
-    ESP32CamAIViewSettings,
-    ESP32CamAIViewTextInput,         // NUOVO
-} ESP32CamAIView;
-
-// Application events
-typedef enum {
-    ESP32CamAIEventStartPressed,
-    ESP32CamAIEventVisionPressed,
-    ESP32CamAIEventMathPressed,
-    ESP32CamAIEventOCRPressed,
-    ESP32CamAIEventCountPressed,
-    ESP32CamAIEventPTTPressed,
-    ESP32CamAIEventFlashOnPressed,
-    ESP32CamAIEventFlashOffPressed,
-    ESP32CamAIEventFlashTogglePressed,
-    ESP32CamAIEventStatusPressed,
-    ESP32CamAIEventSettingsPressed,
-    ESP32CamAIEventCustomVisionPressed,  // NUOVO
-    ESP32CamAIEventCustomChatPressed,    // NUOVO
-    ESP32CamAIEventTextInputDone,        // NUOVO
-    ESP32CamAIEventBack,
-    ESP32CamAIEventUpdateResponse,
-} ESP32CamAIEvent;
-
-// Main application structure
-typedef struct ESP32CamAI ESP32CamAI;
-
-struct ESP32CamAI {
-    Gui* gui;
-    ViewDispatcher* view_dispatcher;
-    SceneManager* scene_manager;
-    
-    // Views
-    Submenu* submenu;
-    TextBox* text_box_response;
-    Popup* popup_ptt;
-    VariableItemList* variable_item_list;
-    TextInput* text_input;              // NUOVO
-    
-    // UART
-    FuriHalSerialHandle* serial_handle;
-    FuriStreamBuffer* rx_stream;
-    FuriThread* worker_thread;
-    FuriTimer* response_timer;
-    
-    // Notifications
-    NotificationApp* notifications;
-    
-    // Data
-    FuriString* response_text;
-    FuriString* line_buffer;
-    char input_buffer[128];             // CORRETTO: buffer char array
-    bool uart_connected;
-    bool ptt_active;
-    bool flash_status;
-    bool response_updated;
-    bool is_vision_mode;                // NUOVO: distingue vision/chat
-    
-    // Navigation state
-    uint32_t current_scene;
-    
-    // Settings
-    uint32_t baudrate;
-};
-
 // Function declarations
 static void esp32_cam_ai_scene_start_callback(void* context, uint32_t index);
 static void esp32_cam_ai_scene_menu_callback(void* context, uint32_t index);
 static void esp32_cam_ai_text_input_callback(void* context);  // NUOVO
 static bool esp32_cam_ai_navigation_exit_callback(void* context);
 
-// UART Functions
-static void esp32_cam_ai_uart_send_command(ESP32CamAI* app, const char* command) {
-    if(app->serial_handle) {
-        furi_hal_serial_tx(app->serial_handle, (const uint8_t*)command, strlen(command));
-        furi_hal_serial_tx(app->serial_handle, (const uint8_t*)"\n", 1);
-        FURI_LOG_I(TAG, "Sent command: %s", command);
-        
-        // Show command sent immediately
-        furi_string_printf(app->response_text, "📤 Sent: %s\nWaiting for response...", command);
-        app->response_updated = true;
-    }
-}
-
-// NUOVO: Invio comando custom con domanda
-static void esp32_cam_ai_uart_send_custom_command(ESP32CamAI* app, const char* prefix, const char* question) {
-    if(app->serial_handle) {
-        // Costruisci comando: "CUSTOM_VISION:domanda" o "CUSTOM_CHAT:domanda"
-        FuriString* full_command = furi_string_alloc();
-        furi_string_printf(full_command, "%s%s", prefix, question);
-        
-        const char* cmd_str = furi_string_get_cstr(full_command);
-        furi_hal_serial_tx(app->serial_handle, (const uint8_t*)cmd_str, strlen(cmd_str));
-        furi_hal_serial_tx(app->serial_handle, (const uint8_t*)"\n", 1);
-        
-        FURI_LOG_I(TAG, "Sent custom command: %s", cmd_str);
-        
-        furi_string_printf(app->response_text, "📤 Question: %s\nProcessing...", question);
-        app->response_updated = true;
-        
-        furi_string_free(full_command);
-    }
+// Share of the free heap outside its largest block, in percent
+static uint32_t esp32_cam_ai_heap_fragmentation(size_t free_bytes, size_t largest_block) {
+    return free_bytes ? 100 - largest_block * 100 / free_bytes : 0;
 }
 
-// Response timer callback to refresh UI
-static void esp32_cam_ai_response_timer_callback(void* context) {
-    ESP32CamAI* app = (ESP32CamAI*)context;
-    
-    if(app->response_updated) {
-        // Send custom event to update response view
-        view_dispatcher_send_custom_event(app->view_dispatcher, ESP32CamAIEventUpdateResponse);
-        app->response_updated = false;
-    }
-}
+// Response view: keeps a line-wrap index over the answer text. Only the
+// open last line and newly appended text are wrapped on each draw, and only
+// the visible rows are rendered.
+typedef struct {
+    const char* text;                   // Front response snapshot, owned by the app
+    size_t length;
+    uint32_t generation;
+    size_t wrapped;                     // Bytes of text already covered by line_start
+    uint16_t line_start[RESPONSE_VIEW_MAX_LINES];
+    uint16_t line_count;                // Last line is open and rewrapped on append
+    uint16_t top;
+    bool pinned;                        // Follow the tail while the answer streams in
+    
+    // Message-to-screen latency, measured on the first draw after an update
+    bool latency_pending;
+    uint32_t change_tick;
+    uint32_t latency_last_ms;
+    uint32_t latency_max_ms;
+    
+    // Final reply already timed for the display stage of the statistics
+    uint32_t stats_final_tick;
+} ESP32CamAIResponseViewModel;
 
-static void esp32_cam_ai_uart_rx_callback(
-    FuriHalSerialHandle* handle,
-    FuriHalSerialRxEvent event,
-    void* context) {
-    UNUSED(handle);
-    ESP32CamAI* app = (ESP32CamAI*)context;
+static void esp32_cam_ai_response_view_wrap(ESP32CamAIResponseViewModel* model, Canvas* canvas) {
+    if(model->wrapped == model->length) return;
     
-    if(event == FuriHalSerialRxEventData) {
-        uint8_t data;
-        data = furi_hal_serial_async_rx(app->serial_handle);
-        furi_stream_buffer_send(app->rx_stream, &data, 1, 0);
-    }
-}
-
-static int32_t esp32_cam_ai_worker(void* context) {
-    ESP32CamAI* app = (ESP32CamAI*)context;
-    uint8_t data;
-    
-    FURI_LOG_I(TAG, "Worker thread started");
-    
-    while(1) {
-        // Read data from stream buffer
-        size_t ret = furi_stream_buffer_receive(app->rx_stream, &data, 1, 100);
-        if(ret > 0) {
-            // Add byte to line buffer
-            if(data == '\n' || data == '\r') {
-                if(furi_string_size(app->line_buffer) > 0) {
-                    // Process complete line
-                    const char* line = furi_string_get_cstr(app->line_buffer);
-                    
-                    FURI_LOG_I(TAG, "Received line: '%s'", line);
-                    
-                    // Process different responses
-                    if(strstr(line, "READY")) {
-                        furi_string_set(app->response_text, "✅ ESP32-CAM Ready");
-                        app->uart_connected = true;
-                    }
-                    else if(strstr(line, "RECORDING")) {
-                        furi_string_set(app->response_text, "🎤 Recording audio...");
-                        app->ptt_active = true;
-                    }
-                    else if(strstr(line, "PROCESSING")) {
-                        furi_string_set(app->response_text, "⚙️ Processing voice...");
-                    }
-                    else if(strstr(line, "FLASH:ON")) {
-                        furi_string_set(app->response_text, "💡 Flash LED ON");
-                        app->flash_status = true;
-                    }
-                    else if(strstr(line, "FLASH:OFF")) {
-                        furi_string_set(app->response_text, "🔲 Flash LED OFF");
-                        app->flash_status = false;
-                    }
-                    else if(strstr(line, "OK:")) {
-                        const char* response = line + 3;
-                        furi_string_printf(app->response_text, "✅ %s", response);
-                        app->ptt_active = false;
-                    }
-                    else if(strstr(line, "ERROR:")) {
-                        const char* error = line + 6;
-                        furi_string_printf(app->response_text, "❌ %s", error);
-                        app->ptt_active = false;
-                    }
-                    else if(strstr(line, "VOICE_RECOGNIZED:")) {
-                        const char* voice_text = line + 17;
-                        furi_string_printf(app->response_text, "🗣️ '%s'", voice_text);
-                    }
-                    else if(strstr(line, "STATUS:")) {
-                        const char* status = line + 7;
-                        furi_string_printf(app->response_text, "ℹ️ %s", status);
-                    }
-                    else if(strlen(line) > 2) {
-                        // Any other response
-                        furi_string_printf(app->response_text, "📥 %s", line);
+    size_t pos = model->line_start[--model->line_count];
+    while(model->line_count < RESPONSE_VIEW_MAX_LINES) {
+        model->line_start[model->line_count++] = pos;
+        
+        size_t width = 0;
+        size_t word_break = pos;
+        size_t i = pos;
+        bool ended = false;
+        while(i < model->length) {
+            char c = model->text[i];
+            if(c == '\n') {
+                i++;
+                ended = true;
+                break;
+            }
+            width += canvas_glyph_width(canvas, (uint8_t)c);
+            if(width > RESPONSE_VIEW_TEXT_WIDTH) {
+                // Never split a UTF-8 sequence; a line gets at least one
+                if(word_break > pos) {
+                    i = word_break;
+                } else {
+                    while(i > pos && ((uint8_t)model->text[i] & 0xC0) == 0x80) i--;
+                    if(i == pos) {
+                        i++;
+                        while(i < model->length && ((uint8_t)model->text[i] & 0xC0) == 0x80) i++;
                     }
-                    
-                    // Mark response as updated
-                    app->response_updated = true;
-                    
-                    // Clear line buffer
-                    furi_string_reset(app->line_buffer);
                 }
-            } else if(furi_string_size(app->line_buffer) < 512) {
-                // Add character to line buffer
-                furi_string_push_back(app->line_buffer, data);
+                ended = true;
+                break;
             }
+            i++;
+            if(c == ' ') word_break = i;
         }
         
-        // Check if thread should exit
-        if(furi_thread_flags_get() & (1UL << 0)) {
-            break;
-        }
+        if(!ended) break;
+        pos = i;
     }
-    
-    FURI_LOG_I(TAG, "Worker thread stopped");
-    return 0;
+    model->wrapped = model->length;
+}
+
+static uint16_t esp32_cam_ai_response_view_max_top(ESP32CamAIResponseViewModel* model) {
+    return model->line_count > RESPONSE_VIEW_ROWS ? model->line_count - RESPONSE_VIEW_ROWS : 0;
 }
 
-static bool esp32_cam_ai_uart_init(ESP32CamAI* app) {
-    FURI_LOG_I(TAG, "Initializing UART...");
+static void esp32_cam_ai_response_view_draw_callback(Canvas* canvas, void* _model) {
+    ESP32CamAIResponseViewModel* model = _model;
     
-    app->serial_handle = furi_hal_serial_control_acquire(UART_CH);
-    if(!app->serial_handle) {
-        FURI_LOG_E(TAG, "Failed to acquire serial handle");
-        return false;
+    canvas_clear(canvas);
+    canvas_set_font(canvas, FontSecondary);
+    
+    if(model->text) {
+        esp32_cam_ai_response_view_wrap(model, canvas);
     }
     
-    furi_hal_serial_init(app->serial_handle, app->baudrate);
-    furi_hal_serial_async_rx_start(app->serial_handle, esp32_cam_ai_uart_rx_callback, app, false);
+    uint16_t max_top = esp32_cam_ai_response_view_max_top(model);
+    if(model->pinned || model->top > max_top) model->top = max_top;
     
-    app->rx_stream = furi_stream_buffer_alloc(1024, 1);
+    char line[RESPONSE_VIEW_LINE_CHARS + 1];
+    for(uint16_t row = 0; row < RESPONSE_VIEW_ROWS; row++) {
+        uint16_t index = model->top + row;
+        if(!model->text || index >= model->line_count) break;
+        
+        size_t start = model->line_start[index];
+        size_t end = index + 1 < model->line_count ? model->line_start[index + 1] : model->length;
+        while(end > start && (model->text[end - 1] == '\n' || model->text[end - 1] == ' ')) end--;
+        
+        size_t length = MIN(end - start, (size_t)RESPONSE_VIEW_LINE_CHARS);
+        memcpy(line, model->text + start, length);
+        line[length] = '\0';
+        canvas_draw_str(canvas, 0, (row + 1) * RESPONSE_VIEW_LINE_HEIGHT - 2, line);
+    }
     
-    app->worker_thread = furi_thread_alloc_ex("ESP32CamWorker", 1024, esp32_cam_ai_worker, app);
-    furi_thread_start(app->worker_thread);
+    if(model->line_count > RESPONSE_VIEW_ROWS) {
+        elements_scrollbar(canvas, model->top, max_top + 1);
+    }
     
-    // Start response timer for UI updates
-    app->response_timer = furi_timer_alloc(esp32_cam_ai_response_timer_callback, FuriTimerTypePeriodic, app);
-    furi_timer_start(app->response_timer, 250); // Update every 250ms
+    if(model->latency_pending) {
+        uint32_t ticks = furi_get_tick() - model->change_tick;
+        model->latency_last_ms = ticks * 1000 / furi_kernel_get_tick_frequency();
+        model->latency_max_ms = MAX(model->latency_max_ms, model->latency_last_ms);
+        model->latency_pending = false;
+    }
+}
+
+static bool esp32_cam_ai_response_view_input_callback(InputEvent* event, void* context) {
+    View* view = context;
+    bool consumed = false;
     
-    FURI_LOG_I(TAG, "UART initialized at %lu baud", app->baudrate);
+    if(event->type != InputTypeShort && event->type != InputTypeRepeat) return false;
     
-    // Send initial STATUS command
-    furi_delay_ms(100);
-    esp32_cam_ai_uart_send_command(app, "STATUS");
+    with_view_model(
+        view,
+        ESP32CamAIResponseViewModel * model,
+        {
+            uint16_t max_top = esp32_cam_ai_response_view_max_top(model);
+            if(event->key == InputKeyUp) {
+                if(model->top > 0) model->top--;
+                model->pinned = false;
+                consumed = true;
+            } else if(event->key == InputKeyDown) {
+                if(model->top < max_top) model->top++;
+                model->pinned = (model->top == max_top);
+                consumed = true;
+            } else if(event->key == InputKeyOk) {
+                // Jump back to the tail and follow it
+                model->pinned = true;
+                consumed = true;
+            }
+        },
+        consumed);
     
-    return true;
+    return consumed;
 }
 
-static void esp32_cam_ai_uart_deinit(ESP32CamAI* app) {
-    if(app->response_timer) {
-        furi_timer_stop(app->response_timer);
-        furi_timer_free(app->response_timer);
-        app->response_timer = NULL;
-    }
+static View* esp32_cam_ai_response_view_alloc(void) {
+    View* view = view_alloc();
+    view_allocate_model(view, ViewModelTypeLocking, sizeof(ESP32CamAIResponseViewModel));
+    view_set_context(view, view);
+    view_set_draw_callback(view, esp32_cam_ai_response_view_draw_callback);
+    view_set_input_callback(view, esp32_cam_ai_response_view_input_callback);
+    
+    with_view_model(
+        view,
+        ESP32CamAIResponseViewModel * model,
+        {
+            memset(model, 0, sizeof(ESP32CamAIResponseViewModel));
+            model->line_count = 1;
+            model->pinned = true;
+        },
+        false);
+    
+    return view;
+}
+
+// Show the latest published answer. A snapshot of the same generation only
+// extends the text on screen, so the wrap index and scroll position are kept.
+static void esp32_cam_ai_response_view_update(ESP32CamAI* app, bool reset) {
+    bool stats_pending = false;
+    ESP32CamAIStatsCommand stats_command = 0;
+    uint32_t stats_final_tick = 0;
+    
+    with_view_model(
+        app->response_view,
+        ESP32CamAIResponseViewModel * model,
+        {
+            const ESP32CamAIResponseSnapshot* snapshot = esp32_cam_ai_response_acquire(app);
+            size_t length = furi_string_size(snapshot->text);
+            
+            if(reset || snapshot->generation != model->generation || length < model->wrapped) {
+                model->line_start[0] = 0;
+                model->line_count = 1;
+                model->wrapped = 0;
+                model->top = 0;
+                model->pinned = true;
+            }
+            model->text = furi_string_get_cstr(snapshot->text);
+            model->length = MIN(length, (size_t)UINT16_MAX);
+            model->generation = snapshot->generation;
+            
+            // Only time snapshots that arrived while the view was showing
+            if(!reset && snapshot->change_tick != model->change_tick) {
+                model->latency_pending = true;
+            }
+            model->change_tick = snapshot->change_tick;
+            
+            // A final reply is timed once, on the first update that shows it
+            if(snapshot->stats_final_tick != model->stats_final_tick) {
+                stats_pending = snapshot->stats_final_tick != 0;
+                stats_command = snapshot->stats_command;
+                stats_final_tick = snapshot->stats_final_tick;
+                model->stats_final_tick = snapshot->stats_final_tick;
+            }
+        },
+        true);
     
-    if(app->worker_thread) {
-        furi_thread_flags_set(furi_thread_get_id(app->worker_thread), (1UL << 0));
-        furi_thread_join(app->worker_thread);
-        furi_thread_free(app->worker_thread);
-        app->worker_thread = NULL;
+    // Recorded outside the model lock, stats_mutex is shared with the worker
+    if(stats_pending) {
+        esp32_cam_ai_stats_record(
+            app, stats_command, ESP32CamAIStatsDisplay, furi_get_tick() - stats_final_tick);
     }
-    
-    if(app->rx_stream) {
-        furi_stream_buffer_free(app->rx_stream);
-        app->rx_stream = NULL;
+}
+
+static void esp32_cam_ai_response_view_get_latency(View* view, uint32_t* last_ms, uint32_t* max_ms) {
+    with_view_model(
+        view,
+        ESP32CamAIResponseViewModel * model,
+        {
+            *last_ms = model->latency_last_ms;
+            *max_ms = model->latency_max_ms;
+        },
+        false);
+}
+
+// Preview view: the framebuffer with a status or timing strip at the bottom
+static void esp32_cam_ai_preview_view_draw_callback(Canvas* canvas, void* _model) {
+    ESP32CamAIPreviewViewModel* model = _model;
+    
+    canvas_clear(canvas);
+    canvas_draw_xbm(canvas, 0, 0, PREVIEW_WIDTH, PREVIEW_HEIGHT, model->framebuffer);
+    
+    char text[32];
+    if(model->status) {
+        snprintf(text, sizeof(text), "%s", model->status);
+    } else if(model->show_stats && model->viewfinder) {
+        snprintf(
+            text,
+            sizeof(text),
+            "%lu.%lu fps  %lu dropped",
+            model->fps_x10 / 10,
+            model->fps_x10 % 10,
+            model->dropped);
+    } else if(model->show_stats && model->valid) {
+        snprintf(
+            text,
+            sizeof(text),
+            "%lums %luus %lu.%luc/px",
+            model->transfer_ms,
+            model->decode_us,
+            model->decode_cpp_x10 / 10,
+            model->decode_cpp_x10 % 10);
+    } else {
+        return;
     }
     
-    if(app->serial_handle) {
-        furi_hal_serial_async_rx_stop(app->serial_handle);
-        furi_hal_serial_deinit(app->serial_handle);
-        furi_hal_serial_control_release(app->serial_handle);
-        app->serial_handle = NULL;
+    canvas_set_color(canvas, ColorWhite);
+    canvas_draw_box(canvas, 0, PREVIEW_HEIGHT - 10, PREVIEW_WIDTH, 10);
+    canvas_set_color(canvas, ColorBlack);
+    canvas_set_font(canvas, FontSecondary);
+    canvas_draw_str(canvas, 1, PREVIEW_HEIGHT - 2, text);
+}
+
+static bool esp32_cam_ai_preview_view_input_callback(InputEvent* event, void* context) {
+    ESP32CamAI* app = context;
+    if(event->type != InputTypeShort) return false;
+    
+    if(event->key == InputKeyOk) {
+        view_dispatcher_send_custom_event(app->view_dispatcher, ESP32CamAIEventPreviewOk);
+        return true;
     }
+    if(event->key == InputKeyUp || event->key == InputKeyDown) {
+        with_view_model(
+            app->preview_view,
+            ESP32CamAIPreviewViewModel * model,
+            { model->show_stats = !model->show_stats; },
+            true);
+        return true;
+    }
+    return false;
+}
+
+static View* esp32_cam_ai_preview_view_alloc(ESP32CamAI* app) {
+    View* view = view_alloc();
+    view_allocate_model(view, ViewModelTypeLocking, sizeof(ESP32CamAIPreviewViewModel));
+    view_set_context(view, app);
+    view_set_draw_callback(view, esp32_cam_ai_preview_view_draw_callback);
+    view_set_input_callback(view, esp32_cam_ai_preview_view_input_callback);
+    
+    with_view_model(
+        view,
+        ESP32CamAIPreviewViewModel * model,
+        {
+            memset(model, 0, sizeof(ESP32CamAIPreviewViewModel));
+            memset(app->preview_buffers, 0, sizeof(app->preview_buffers));
+            model->framebuffer = app->preview_buffers[0];
+            model->show_stats = true;
+        },
+        false);
+    app->preview_back = app->preview_buffers[1];
+    
+    return view;
 }
 
 // Scene: Start
@@ -333,7 +341,11 @@ static bool esp32_cam_ai_scene_start_on_event(void* context, SceneManagerEvent e
                 if(esp32_cam_ai_uart_init(app)) {
                     scene_manager_next_scene(app->scene_manager, ESP32CamAISceneMenu);
                 } else {
-                    furi_string_set(app->response_text, "❌ UART Init Failed");
+                    // No worker is running, so the GUI may publish directly
+                    app->request = &app->requests[0];
+                    app->request_focus = 0;
+                    esp32_cam_ai_response_set(app, "❌ UART Init Failed");
+                    esp32_cam_ai_response_publish(app);
                     scene_manager_next_scene(app->scene_manager, ESP32CamAISceneResponse);
                 }
                 consumed = true;
@@ -365,6 +377,9 @@ static void esp32_cam_ai_scene_menu_on_enter(void* context) {
     submenu_add_item(app->submenu, "🧮 Math Solver", ESP32CamAIEventMathPressed, esp32_cam_ai_scene_menu_callback, app);
     submenu_add_item(app->submenu, "📝 Text OCR", ESP32CamAIEventOCRPressed, esp32_cam_ai_scene_menu_callback, app);
     submenu_add_item(app->submenu, "🔢 Count Objects", ESP32CamAIEventCountPressed, esp32_cam_ai_scene_menu_callback, app);
+    submenu_add_item(app->submenu, "🖼️ Camera Preview", ESP32CamAIEventPreviewPressed, esp32_cam_ai_scene_menu_callback, app);
+    submenu_add_item(app->submenu, "🎯 Viewfinder", ESP32CamAIEventViewfinderPressed, esp32_cam_ai_scene_menu_callback, app);
+    submenu_add_item(app->submenu, "📊 Stats", ESP32CamAIEventStatsPressed, esp32_cam_ai_scene_menu_callback, app);
     
     // NUOVO: Custom Questions
     submenu_add_item(app->submenu, "❓ Custom Vision", ESP32CamAIEventCustomVisionPressed, esp32_cam_ai_scene_menu_callback, app);
@@ -396,71 +411,86 @@ static bool esp32_cam_ai_scene_menu_on_event(void* context, SceneManagerEvent ev
                 scene_manager_next_scene(app->scene_manager, ESP32CamAISceneResponse);
                 consumed = true;
                 break;
-                
+            
             case ESP32CamAIEventMathPressed:
                 esp32_cam_ai_uart_send_command(app, "MATH");
                 scene_manager_next_scene(app->scene_manager, ESP32CamAISceneResponse);
                 consumed = true;
                 break;
-                
+            
             case ESP32CamAIEventOCRPressed:
                 esp32_cam_ai_uart_send_command(app, "OCR");
                 scene_manager_next_scene(app->scene_manager, ESP32CamAISceneResponse);
                 consumed = true;
                 break;
-                
+            
             case ESP32CamAIEventCountPressed:
                 esp32_cam_ai_uart_send_command(app, "COUNT");
                 scene_manager_next_scene(app->scene_manager, ESP32CamAISceneResponse);
                 consumed = true;
                 break;
-                
+            
             // NUOVO: Custom Questions
             case ESP32CamAIEventCustomVisionPressed:
                 app->is_vision_mode = true;
                 scene_manager_next_scene(app->scene_manager, ESP32CamAISceneTextInput);
                 consumed = true;
                 break;
-                
+            
             case ESP32CamAIEventCustomChatPressed:
                 app->is_vision_mode = false;
                 scene_manager_next_scene(app->scene_manager, ESP32CamAISceneTextInput);
                 consumed = true;
                 break;
-                
+            
             case ESP32CamAIEventPTTPressed:
                 scene_manager_next_scene(app->scene_manager, ESP32CamAIScenePTT);
                 consumed = true;
                 break;
-                
+            
             case ESP32CamAIEventFlashOnPressed:
                 esp32_cam_ai_uart_send_command(app, "FLASH_ON");
                 scene_manager_next_scene(app->scene_manager, ESP32CamAISceneResponse);
                 consumed = true;
                 break;
-                
+            
             case ESP32CamAIEventFlashOffPressed:
                 esp32_cam_ai_uart_send_command(app, "FLASH_OFF");
                 scene_manager_next_scene(app->scene_manager, ESP32CamAISceneResponse);
                 consumed = true;
                 break;
-                
+            
             case ESP32CamAIEventFlashTogglePressed:
                 esp32_cam_ai_uart_send_command(app, "FLASH_TOGGLE");
                 scene_manager_next_scene(app->scene_manager, ESP32CamAISceneResponse);
                 consumed = true;
                 break;
-                
+            
             case ESP32CamAIEventStatusPressed:
                 esp32_cam_ai_uart_send_command(app, "STATUS");
                 scene_manager_next_scene(app->scene_manager, ESP32CamAISceneResponse);
                 consumed = true;
                 break;
-                
+            
             case ESP32CamAIEventSettingsPressed:
                 scene_manager_next_scene(app->scene_manager, ESP32CamAISceneSettings);
                 consumed = true;
                 break;
+            
+            case ESP32CamAIEventPreviewPressed:
+                scene_manager_next_scene(app->scene_manager, ESP32CamAIScenePreview);
+                consumed = true;
+                break;
+            
+            case ESP32CamAIEventViewfinderPressed:
+                scene_manager_next_scene(app->scene_manager, ESP32CamAISceneViewfinder);
+                consumed = true;
+                break;
+            
+            case ESP32CamAIEventStatsPressed:
+                scene_manager_next_scene(app->scene_manager, ESP32CamAISceneStats);
+                consumed = true;
+                break;
         }
     }
     
@@ -559,9 +589,7 @@ static void esp32_cam_ai_text_input_callback(void* context) {
 static void esp32_cam_ai_scene_response_on_enter(void* context) {
     ESP32CamAI* app = (ESP32CamAI*)context;
     
-    text_box_reset(app->text_box_response);
-    text_box_set_text(app->text_box_response, furi_string_get_cstr(app->response_text));
-    text_box_set_focus(app->text_box_response, TextBoxFocusStart);
+    esp32_cam_ai_response_view_update(app, true);
     
     view_dispatcher_switch_to_view(app->view_dispatcher, ESP32CamAIViewResponse);
 }
@@ -576,12 +604,9 @@ static bool esp32_cam_ai_scene_response_on_event(void* context, SceneManagerEven
                 scene_manager_previous_scene(app->scene_manager);
                 consumed = true;
                 break;
-                
+            
             case ESP32CamAIEventUpdateResponse:
-                // Update the text box with new response
-                text_box_reset(app->text_box_response);
-                text_box_set_text(app->text_box_response, furi_string_get_cstr(app->response_text));
-                text_box_set_focus(app->text_box_response, TextBoxFocusStart);
+                esp32_cam_ai_response_view_update(app, false);
                 consumed = true;
                 break;
         }
@@ -597,8 +622,226 @@ static bool esp32_cam_ai_scene_response_on_event(void* context, SceneManagerEven
 }
 
 static void esp32_cam_ai_scene_response_on_exit(void* context) {
+    UNUSED(context);
+}
+
+// Scene: Camera Preview
+static void esp32_cam_ai_scene_preview_request(ESP32CamAI* app) {
+    bool framed = esp32_cam_ai_link_mode(app) & ESP32CamAILinkModeFramed;
+    
+    with_view_model(
+        app->preview_view,
+        ESP32CamAIPreviewViewModel * model,
+        { model->status = framed ? "Requesting..." : "Needs framed link"; },
+        true);
+    
+    if(framed) esp32_cam_ai_uart_send_command(app, "PREVIEW");
+}
+
+static void esp32_cam_ai_scene_preview_on_enter(void* context) {
+    ESP32CamAI* app = (ESP32CamAI*)context;
+    
+    esp32_cam_ai_scene_preview_request(app);
+    
+    view_dispatcher_switch_to_view(app->view_dispatcher, ESP32CamAIViewPreview);
+}
+
+static bool esp32_cam_ai_scene_preview_on_event(void* context, SceneManagerEvent event) {
+    ESP32CamAI* app = (ESP32CamAI*)context;
+    bool consumed = false;
+    
+    if(event.type == SceneManagerEventTypeCustom) {
+        switch(event.event) {
+            case ESP32CamAIEventBack:
+                scene_manager_previous_scene(app->scene_manager);
+                consumed = true;
+                break;
+            
+            case ESP32CamAIEventPreviewOk:
+                esp32_cam_ai_scene_preview_request(app);
+                consumed = true;
+                break;
+        }
+    }
+    
+    // Handle back button press
+    if(event.type == SceneManagerEventTypeBack) {
+        scene_manager_previous_scene(app->scene_manager);
+        consumed = true;
+    }
+    
+    return consumed;
+}
+
+static void esp32_cam_ai_scene_preview_on_exit(void* context) {
+    UNUSED(context);
+}
+
+// Scene: Viewfinder
+static void esp32_cam_ai_viewfinder_enable(ESP32CamAI* app, bool enable) {
+    app->viewfinder_enabled = enable;
+    if(app->worker_thread) {
+        furi_thread_flags_set(furi_thread_get_id(app->worker_thread), ESP32CamAIWorkerEventViewfinder);
+    }
+}
+
+static void esp32_cam_ai_scene_viewfinder_on_enter(void* context) {
     ESP32CamAI* app = (ESP32CamAI*)context;
-    text_box_reset(app->text_box_response);
+    bool framed = esp32_cam_ai_link_mode(app) & ESP32CamAILinkModeFramed;
+    
+    with_view_model(
+        app->preview_view,
+        ESP32CamAIPreviewViewModel * model,
+        {
+            model->viewfinder = true;
+            model->fps_x10 = 0;
+            model->dropped = 0;
+            model->status = framed ? "Starting..." : "Needs framed link";
+        },
+        true);
+    esp32_cam_ai_viewfinder_enable(app, framed);
+    
+    view_dispatcher_switch_to_view(app->view_dispatcher, ESP32CamAIViewPreview);
+}
+
+static bool esp32_cam_ai_scene_viewfinder_on_event(void* context, SceneManagerEvent event) {
+    ESP32CamAI* app = (ESP32CamAI*)context;
+    bool consumed = false;
+    
+    if(event.type == SceneManagerEventTypeCustom) {
+        switch(event.event) {
+            case ESP32CamAIEventBack:
+                scene_manager_previous_scene(app->scene_manager);
+                consumed = true;
+                break;
+            
+            case ESP32CamAIEventPreviewOk: {
+                // Ask about the frame on screen if the peer numbers its frames
+                uint32_t frame_id = 0;
+                with_view_model(
+                    app->preview_view,
+                    ESP32CamAIPreviewViewModel * model,
+                    { frame_id = model->valid ? model->frame_id : 0; },
+                    false);
+                
+                char command[24];
+                if(frame_id) {
+                    snprintf(command, sizeof(command), "VISION_FRAME:%lu", frame_id);
+                } else {
+                    snprintf(command, sizeof(command), "VISION");
+                }
+                esp32_cam_ai_uart_send_command(app, command);
+                scene_manager_next_scene(app->scene_manager, ESP32CamAISceneResponse);
+                consumed = true;
+                break;
+            }
+        }
+    }
+    
+    // Handle back button press
+    if(event.type == SceneManagerEventTypeBack) {
+        scene_manager_previous_scene(app->scene_manager);
+        consumed = true;
+    }
+    
+    return consumed;
+}
+
+static void esp32_cam_ai_scene_viewfinder_on_exit(void* context) {
+    ESP32CamAI* app = (ESP32CamAI*)context;
+    
+    esp32_cam_ai_viewfinder_enable(app, false);
+    with_view_model(
+        app->preview_view,
+        ESP32CamAIPreviewViewModel * model,
+        {
+            model->viewfinder = false;
+            model->status = NULL;
+        },
+        false);
+}
+
+static void esp32_cam_ai_stats_export_callback(GuiButtonType result, InputType type, void* context) {
+    ESP32CamAI* app = context;
+    if(result == GuiButtonTypeCenter && type == InputTypeShort) {
+        view_dispatcher_send_custom_event(app->view_dispatcher, ESP32CamAIEventStatsExport);
+    }
+}
+
+// Scene: Stats. OK exports the histograms shown to STATS_PATH.
+static void esp32_cam_ai_scene_stats_show(ESP32CamAI* app, bool export) {
+    FuriString* text = app->stats_text;
+    
+    // The worker keeps recording, so work from a consistent copy
+    ESP32CamAIHistogram(*stats)[ESP32CamAIStatsStageCount] = malloc(sizeof(app->stats));
+    furi_mutex_acquire(app->stats_mutex, FuriWaitForever);
+    memcpy(stats, app->stats, sizeof(app->stats));
+    furi_mutex_release(app->stats_mutex);
+    
+    furi_string_reset(text);
+    if(export) {
+        furi_string_cat_str(
+            text, esp32_cam_ai_stats_export(stats) ? "💾 Saved to stats.csv\n" : "❌ stats.csv not saved\n");
+    }
+    furi_string_cat_str(text, "min/p50/p95/max ms\n");
+    
+    bool any = false;
+    for(size_t command = 0; command < ESP32CamAIStatsCount; command++) {
+        if(!stats[command][ESP32CamAIStatsQueue].count) continue;
+        any = true;
+        furi_string_cat_printf(
+            text, "\n%s (%lu)\n", esp32_cam_ai_stats_commands[command],
+            stats[command][ESP32CamAIStatsQueue].count);
+        for(size_t stage = 0; stage < ESP32CamAIStatsStageCount; stage++) {
+            const ESP32CamAIHistogram* histogram = &stats[command][stage];
+            if(!histogram->count) continue;
+            furi_string_cat_printf(
+                text,
+                "%s: %lu/%lu/%lu/%lu\n",
+                esp32_cam_ai_stats_stages[stage],
+                histogram->min_ms,
+                esp32_cam_ai_stats_percentile(histogram, 50),
+                esp32_cam_ai_stats_percentile(histogram, 95),
+                histogram->max_ms);
+        }
+    }
+    if(!any) furi_string_cat_str(text, "\nNo commands timed yet");
+    free(stats);
+    
+    widget_reset(app->widget_stats);
+    widget_add_text_scroll_element(app->widget_stats, 0, 0, 128, 52, furi_string_get_cstr(text));
+    widget_add_button_element(
+        app->widget_stats, GuiButtonTypeCenter, "Export", esp32_cam_ai_stats_export_callback, app);
+}
+
+static void esp32_cam_ai_scene_stats_on_enter(void* context) {
+    ESP32CamAI* app = (ESP32CamAI*)context;
+    
+    esp32_cam_ai_scene_stats_show(app, false);
+    view_dispatcher_switch_to_view(app->view_dispatcher, ESP32CamAIViewStats);
+}
+
+static bool esp32_cam_ai_scene_stats_on_event(void* context, SceneManagerEvent event) {
+    ESP32CamAI* app = (ESP32CamAI*)context;
+    bool consumed = false;
+    
+    if(event.type == SceneManagerEventTypeCustom && event.event == ESP32CamAIEventStatsExport) {
+        esp32_cam_ai_scene_stats_show(app, true);
+        consumed = true;
+    }
+    
+    // Handle back button press
+    if(event.type == SceneManagerEventTypeBack) {
+        scene_manager_previous_scene(app->scene_manager);
+        consumed = true;
+    }
+    
+    return consumed;
+}
+
+static void esp32_cam_ai_scene_stats_on_exit(void* context) {
+    ESP32CamAI* app = (ESP32CamAI*)context;
+    widget_reset(app->widget_stats);
 }
 
 // Scene: PTT (Push-to-Talk)
@@ -653,6 +896,175 @@ static void esp32_cam_ai_scene_ptt_on_exit(void* context) {
 }
 
 // Scene: Settings
+static const uint32_t esp32_cam_ai_baudrate_values[] = {115200, 230400, 460800, 921600, 2000000};
+static const uint32_t esp32_cam_ai_response_cap_values[] = {1024, 2048, 4096, 8192};
+static const uint32_t esp32_cam_ai_flow_window_values[] = {256, 512, 768, 896};
+static const char* const esp32_cam_ai_dither_names[ESP32CamAIDitherCount] = {"Threshold", "Bayer", "Diffusion"};
+static const char* const esp32_cam_ai_trace_mode_names[ESP32CamAITraceModeCount] = {"OFF", "Capture", "Replay", "Fast"};
+
+// Settings rows in list order, up to the read-only statistics
+typedef enum {
+    ESP32CamAISettingsItemBaudrate,
+    ESP32CamAISettingsItemResponseCap,
+    ESP32CamAISettingsItemFlowWindow,
+    ESP32CamAISettingsItemDither,
+    ESP32CamAISettingsItemCacheStats,
+    ESP32CamAISettingsItemCacheClear,
+    ESP32CamAISettingsItemArchive,
+    ESP32CamAISettingsItemArchiveStats,
+    ESP32CamAISettingsItemTrace,
+    ESP32CamAISettingsItemTraceStats,
+    ESP32CamAISettingsItemSecondCamera,
+} ESP32CamAISettingsItem;
+
+static void esp32_cam_ai_settings_load(ESP32CamAI* app) {
+    ESP32CamAISettings settings;
+    if(!saved_struct_load(
+           SETTINGS_PATH, &settings, sizeof(settings), SETTINGS_MAGIC, SETTINGS_VERSION)) {
+        return;
+    }
+    
+    // Only accept values the selectors can show
+    for(size_t i = 0; i < COUNT_OF(esp32_cam_ai_baudrate_values); i++) {
+        if(esp32_cam_ai_baudrate_values[i] == settings.baudrate) {
+            app->baudrate_requested = settings.baudrate;
+            app->baudrate_verified = settings.baudrate;
+        }
+    }
+    for(size_t i = 0; i < COUNT_OF(esp32_cam_ai_response_cap_values); i++) {
+        if(esp32_cam_ai_response_cap_values[i] == settings.response_cap) {
+            app->response_cap = settings.response_cap;
+        }
+    }
+    for(size_t i = 0; i < COUNT_OF(esp32_cam_ai_flow_window_values); i++) {
+        if(esp32_cam_ai_flow_window_values[i] == settings.flow_window) {
+            app->flow_window = settings.flow_window;
+        }
+    }
+    if(settings.preview_dither < ESP32CamAIDitherCount) {
+        app->preview_dither = settings.preview_dither;
+    }
+    app->archive_enabled = settings.archive != 0;
+    if(settings.trace < ESP32CamAITraceModeCount) {
+        app->trace_mode = settings.trace;
+    }
+    app->second_camera = settings.second_camera != 0;
+}
+
+static void esp32_cam_ai_settings_save(ESP32CamAI* app) {
+    ESP32CamAISettings settings = {
+        .baudrate = __atomic_load_n(&app->baudrate_verified, __ATOMIC_RELAXED),
+        .response_cap = app->response_cap,
+        .preview_dither = app->preview_dither,
+        .archive = app->archive_enabled,
+        .flow_window = app->flow_window,
+        .trace = app->trace_mode,
+        .second_camera = app->second_camera,
+    };
+    saved_struct_save(SETTINGS_PATH, &settings, sizeof(settings), SETTINGS_MAGIC, SETTINGS_VERSION);
+}
+
+static void esp32_cam_ai_baudrate_changed(VariableItem* item) {
+    ESP32CamAI* app = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+    
+    // The worker owns the rate it negotiates and takes this one on the event
+    uint32_t baudrate = esp32_cam_ai_baudrate_values[index];
+    __atomic_store_n(&app->baudrate_requested, baudrate, __ATOMIC_RELAXED);
+    
+    char baudrate_text[16];
+    snprintf(baudrate_text, sizeof(baudrate_text), "%lu", baudrate);
+    variable_item_set_current_value_text(item, baudrate_text);
+    
+    if(app->worker_thread) {
+        furi_thread_flags_set(furi_thread_get_id(app->worker_thread), ESP32CamAIWorkerEventBaud);
+    }
+}
+
+static void esp32_cam_ai_response_cap_changed(VariableItem* item) {
+    ESP32CamAI* app = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+    
+    // A smaller cap applies right away, a larger one needs the bigger
+    // arenas of the next launch
+    app->response_cap = esp32_cam_ai_response_cap_values[index];
+    uint32_t active = esp32_cam_ai_response_cap_apply(app);
+    
+    char cap_text[16];
+    if(active < app->response_cap) {
+        snprintf(cap_text, sizeof(cap_text), "%luK restart", app->response_cap / 1024);
+    } else {
+        snprintf(cap_text, sizeof(cap_text), "%lu B", app->response_cap);
+    }
+    variable_item_set_current_value_text(item, cap_text);
+}
+
+static void esp32_cam_ai_flow_window_changed(VariableItem* item) {
+    ESP32CamAI* app = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+    
+    // Offered to the peer with the next READY
+    app->flow_window = esp32_cam_ai_flow_window_values[index];
+    
+    char window_text[16];
+    snprintf(window_text, sizeof(window_text), "%lu B", app->flow_window);
+    variable_item_set_current_value_text(item, window_text);
+}
+
+static void esp32_cam_ai_preview_dither_changed(VariableItem* item) {
+    ESP32CamAI* app = variable_item_get_context(item);
+    
+    // Applies from the next frame, the worker reads it when a preview starts
+    app->preview_dither = variable_item_get_current_value_index(item);
+    variable_item_set_current_value_text(item, esp32_cam_ai_dither_names[app->preview_dither]);
+}
+
+static void esp32_cam_ai_archive_changed(VariableItem* item) {
+    ESP32CamAI* app = variable_item_get_context(item);
+    
+    app->archive_enabled = variable_item_get_current_value_index(item);
+    variable_item_set_current_value_text(item, app->archive_enabled ? "ON" : "OFF");
+    
+    if(app->worker_thread) {
+        furi_thread_flags_set(furi_thread_get_id(app->worker_thread), ESP32CamAIWorkerEventArchive);
+    }
+}
+
+static void esp32_cam_ai_trace_mode_changed(VariableItem* item) {
+    ESP32CamAI* app = variable_item_get_context(item);
+    
+    // Takes effect at the next launch, when the worker starts from scratch
+    app->trace_mode = variable_item_get_current_value_index(item);
+    variable_item_set_current_value_text(item, esp32_cam_ai_trace_mode_names[app->trace_mode]);
+}
+
+static void esp32_cam_ai_second_camera_changed(VariableItem* item) {
+    ESP32CamAI* app = variable_item_get_context(item);
+    
+    // The LPUART is acquired when the UART starts, so this applies from the next launch
+    app->second_camera = variable_item_get_current_value_index(item);
+    variable_item_set_current_value_text(item, app->second_camera ? "LPUART" : "OFF");
+}
+
+static void esp32_cam_ai_settings_enter_callback(void* context, uint32_t index) {
+    ESP32CamAI* app = (ESP32CamAI*)context;
+    if(index == ESP32CamAISettingsItemCacheClear) {
+        view_dispatcher_send_custom_event(app->view_dispatcher, ESP32CamAIEventCacheClearPressed);
+    }
+}
+
+// Clear through the cache thread while it owns the index, directly otherwise
+static void esp32_cam_ai_settings_clear_cache(ESP32CamAI* app) {
+    if(app->cache_queue) {
+        ESP32CamAICacheMessage message = {.op = ESP32CamAICacheOpClear};
+        furi_message_queue_put(app->cache_queue, &message, FuriWaitForever);
+    } else {
+        esp32_cam_ai_cache_clear(app, furi_record_open(RECORD_STORAGE));
+        furi_record_close(RECORD_STORAGE);
+    }
+    variable_item_set_current_value_text(app->settings_cache_item, "Cleared");
+}
+
 static void esp32_cam_ai_scene_settings_on_enter(void* context) {
     ESP32CamAI* app = (ESP32CamAI*)context;
     
@@ -661,15 +1073,227 @@ static void esp32_cam_ai_scene_settings_on_enter(void* context) {
     VariableItem* item = variable_item_list_add(
         app->variable_item_list,
         "Baudrate",
-        1,
-        NULL,
-        NULL
+        COUNT_OF(esp32_cam_ai_baudrate_values),
+        esp32_cam_ai_baudrate_changed,
+        app
     );
     
-    char baudrate_text[32];
-    snprintf(baudrate_text, sizeof(baudrate_text), "%lu", app->baudrate);
+    uint8_t baudrate_index = 0;
+    for(size_t i = 0; i < COUNT_OF(esp32_cam_ai_baudrate_values); i++) {
+        if(esp32_cam_ai_baudrate_values[i] == app->baudrate_requested) baudrate_index = i;
+    }
+    variable_item_set_current_value_index(item, baudrate_index);
+    
+    char baudrate_text[16];
+    snprintf(baudrate_text, sizeof(baudrate_text), "%lu", app->baudrate_requested);
     variable_item_set_current_value_text(item, baudrate_text);
     
+    item = variable_item_list_add(
+        app->variable_item_list,
+        "Answer Cap",
+        COUNT_OF(esp32_cam_ai_response_cap_values),
+        esp32_cam_ai_response_cap_changed,
+        app
+    );
+    
+    uint8_t cap_index = 0;
+    for(size_t i = 0; i < COUNT_OF(esp32_cam_ai_response_cap_values); i++) {
+        if(esp32_cam_ai_response_cap_values[i] == app->response_cap) cap_index = i;
+    }
+    variable_item_set_current_value_index(item, cap_index);
+    esp32_cam_ai_response_cap_changed(item);
+    
+    item = variable_item_list_add(
+        app->variable_item_list,
+        "RX High Water",
+        COUNT_OF(esp32_cam_ai_flow_window_values),
+        esp32_cam_ai_flow_window_changed,
+        app
+    );
+    
+    uint8_t window_index = 0;
+    for(size_t i = 0; i < COUNT_OF(esp32_cam_ai_flow_window_values); i++) {
+        if(esp32_cam_ai_flow_window_values[i] == app->flow_window) window_index = i;
+    }
+    variable_item_set_current_value_index(item, window_index);
+    esp32_cam_ai_flow_window_changed(item);
+    
+    item = variable_item_list_add(
+        app->variable_item_list,
+        "Preview Dither",
+        ESP32CamAIDitherCount,
+        esp32_cam_ai_preview_dither_changed,
+        app
+    );
+    variable_item_set_current_value_index(item, app->preview_dither);
+    esp32_cam_ai_preview_dither_changed(item);
+    
+    char stat_text[16];
+    
+    item = variable_item_list_add(app->variable_item_list, "Cache Hit/Miss", 1, NULL, NULL);
+    snprintf(stat_text, sizeof(stat_text), "%lu/%lu", app->cache_hits, app->cache_misses);
+    variable_item_set_current_value_text(item, stat_text);
+    
+    app->settings_cache_item = variable_item_list_add(app->variable_item_list, "Clear Cache", 1, NULL, NULL);
+    variable_item_set_current_value_text(app->settings_cache_item, "OK");
+    variable_item_list_set_enter_callback(
+        app->variable_item_list, esp32_cam_ai_settings_enter_callback, app);
+    
+    item = variable_item_list_add(
+        app->variable_item_list, "Archive Captures", 2, esp32_cam_ai_archive_changed, app);
+    variable_item_set_current_value_index(item, app->archive_enabled);
+    variable_item_set_current_value_text(item, app->archive_enabled ? "ON" : "OFF");
+    
+    item = variable_item_list_add(app->variable_item_list, "Archived", 1, NULL, NULL);
+    snprintf(
+        stat_text,
+        sizeof(stat_text),
+        "%lu %luKB/s",
+        app->archive_saved,
+        app->archive_rate / 1024);
+    variable_item_set_current_value_text(item, stat_text);
+    
+    item = variable_item_list_add(
+        app->variable_item_list,
+        "UART Trace",
+        ESP32CamAITraceModeCount,
+        esp32_cam_ai_trace_mode_changed,
+        app);
+    variable_item_set_current_value_index(item, app->trace_mode);
+    esp32_cam_ai_trace_mode_changed(item);
+    
+    item = variable_item_list_add(app->variable_item_list, "Traced", 1, NULL, NULL);
+    if(app->trace_session == ESP32CamAITraceCapture) {
+        snprintf(stat_text, sizeof(stat_text), "%luKB%s", app->trace_bytes / 1024, app->trace_cut ? " cut" : "");
+    } else if(app->trace_session != ESP32CamAITraceOff) {
+        snprintf(stat_text, sizeof(stat_text), "%lu/%lu ok", app->trace_matched, app->trace_checked);
+    } else {
+        snprintf(stat_text, sizeof(stat_text), "-");
+    }
+    variable_item_set_current_value_text(item, stat_text);
+    
+    item = variable_item_list_add(
+        app->variable_item_list, "Second Camera", 2, esp32_cam_ai_second_camera_changed, app);
+    variable_item_set_current_value_index(item, app->second_camera);
+    variable_item_set_current_value_text(item, app->second_camera ? "LPUART" : "OFF");
+    
+    // RX link statistics (read-only)
+    
+    item = variable_item_list_add(app->variable_item_list, "Link Baud", 1, NULL, NULL);
+    snprintf(stat_text, sizeof(stat_text), "%lu", app->baudrate);
+    variable_item_set_current_value_text(item, stat_text);
+    
+    item = variable_item_list_add(app->variable_item_list, "Link Up", 1, NULL, NULL);
+    if(app->startup_ready_ms) {
+        snprintf(stat_text, sizeof(stat_text), "%lums", app->startup_ready_ms);
+    } else {
+        snprintf(stat_text, sizeof(stat_text), "-");
+    }
+    variable_item_set_current_value_text(item, stat_text);
+    
+    item = variable_item_list_add(app->variable_item_list, "First Cmd", 1, NULL, NULL);
+    if(app->startup_command_ms) {
+        snprintf(stat_text, sizeof(stat_text), "%lums", app->startup_command_ms);
+    } else {
+        snprintf(stat_text, sizeof(stat_text), "-");
+    }
+    variable_item_set_current_value_text(item, stat_text);
+    
+    item = variable_item_list_add(app->variable_item_list, "RX Bytes", 1, NULL, NULL);
+    snprintf(stat_text, sizeof(stat_text), "%lu", app->main_link.rx_bytes);
+    variable_item_set_current_value_text(item, stat_text);
+    
+    item = variable_item_list_add(app->variable_item_list, "RX Dropped", 1, NULL, NULL);
+    snprintf(stat_text, sizeof(stat_text), "%lu", app->main_link.rx_dropped);
+    variable_item_set_current_value_text(item, stat_text);
+    
+    uint32_t link_mode = esp32_cam_ai_link_mode(app);
+    item = variable_item_list_add(app->variable_item_list, "RX Pauses", 1, NULL, NULL);
+    if(link_mode & ESP32CamAILinkModeFlow) {
+        snprintf(stat_text, sizeof(stat_text), "%lu", app->flow_pauses);
+    } else {
+        snprintf(stat_text, sizeof(stat_text), "No flow ctrl");
+    }
+    variable_item_set_current_value_text(item, stat_text);
+    
+    item = variable_item_list_add(app->variable_item_list, "RX Overruns", 1, NULL, NULL);
+    snprintf(stat_text, sizeof(stat_text), "%lu", app->main_link.rx_overruns);
+    variable_item_set_current_value_text(item, stat_text);
+    
+    item = variable_item_list_add(app->variable_item_list, "Link Mode", 1, NULL, NULL);
+    snprintf(
+        stat_text,
+        sizeof(stat_text),
+        "%s%s%s",
+        (link_mode & ESP32CamAILinkModeFramed) ? "Framed" : "Text",
+        (link_mode & ESP32CamAILinkModeTagged) ? "+Tags" : "",
+        (link_mode & ESP32CamAILinkModeCompressed) ? "+LZ" : "");
+    variable_item_set_current_value_text(item, stat_text);
+    
+    item = variable_item_list_add(app->variable_item_list, "Answer B/s", 1, NULL, NULL);
+    snprintf(stat_text, sizeof(stat_text), "%lu/%lu", app->stream_text_rate, app->stream_wire_rate);
+    variable_item_set_current_value_text(item, stat_text);
+    
+    uint32_t in_flight = 0;
+    for(size_t i = 1; i <= REQUEST_INFLIGHT_MAX; i++) {
+        if(app->requests[i].pending) in_flight++;
+    }
+    uint32_t parse_cost_x10 = esp32_cam_ai_parse_cost_x10(app);
+    item = variable_item_list_add(app->variable_item_list, "RX Cost", 1, NULL, NULL);
+    snprintf(stat_text, sizeof(stat_text), "%lu.%lu cyc/B", parse_cost_x10 / 10, parse_cost_x10 % 10);
+    variable_item_set_current_value_text(item, stat_text);
+    
+    item = variable_item_list_add(app->variable_item_list, "Idle Wakeups", 1, NULL, NULL);
+    if(app->worker_thread) {
+        uint32_t idle_x10 = esp32_cam_ai_worker_wakeup_rate_x10(app, app->worker_idle_wakeups);
+        snprintf(stat_text, sizeof(stat_text), "%lu.%lu/s", idle_x10 / 10, idle_x10 % 10);
+    } else {
+        snprintf(stat_text, sizeof(stat_text), "-");
+    }
+    variable_item_set_current_value_text(item, stat_text);
+    
+    item = variable_item_list_add(app->variable_item_list, "In Flight", 1, NULL, NULL);
+    snprintf(stat_text, sizeof(stat_text), "%lu/%d", in_flight, REQUEST_INFLIGHT_MAX);
+    variable_item_set_current_value_text(item, stat_text);
+    
+    item = variable_item_list_add(app->variable_item_list, "Bad Frames", 1, NULL, NULL);
+    snprintf(stat_text, sizeof(stat_text), "%lu/%lu", app->frames_bad, app->frames_bad + app->frames_ok);
+    variable_item_set_current_value_text(item, stat_text);
+    
+    uint32_t latency_last_ms, latency_max_ms;
+    esp32_cam_ai_response_view_get_latency(app->response_view, &latency_last_ms, &latency_max_ms);
+    item = variable_item_list_add(app->variable_item_list, "UI Latency", 1, NULL, NULL);
+    snprintf(stat_text, sizeof(stat_text), "%lu/%lums", latency_last_ms, latency_max_ms);
+    variable_item_set_current_value_text(item, stat_text);
+    
+    // Heap now against app start, and the system-wide low-water mark
+    size_t heap_free = memmgr_get_free_heap();
+    item = variable_item_list_add(app->variable_item_list, "Heap Free", 1, NULL, NULL);
+    snprintf(
+        stat_text,
+        sizeof(stat_text),
+        "%u/%uK",
+        heap_free / 1024,
+        memmgr_get_minimum_free_heap() / 1024);
+    variable_item_set_current_value_text(item, stat_text);
+    
+    item = variable_item_list_add(app->variable_item_list, "Heap Frag", 1, NULL, NULL);
+    snprintf(
+        stat_text,
+        sizeof(stat_text),
+        "%lu%% was %lu%%",
+        esp32_cam_ai_heap_fragmentation(heap_free, memmgr_heap_get_max_free_block()),
+        esp32_cam_ai_heap_fragmentation(app->heap_free_start, app->heap_block_start));
+    variable_item_set_current_value_text(item, stat_text);
+    
+    size_t arena_peak = 0;
+    for(size_t i = 0; i < COUNT_OF(app->requests); i++) {
+        arena_peak = MAX(arena_peak, app->requests[i].arena_peak);
+    }
+    item = variable_item_list_add(app->variable_item_list, "Arena Peak", 1, NULL, NULL);
+    snprintf(stat_text, sizeof(stat_text), "%u/%u", arena_peak, app->request_arena_size);
+    variable_item_set_current_value_text(item, stat_text);
+    
     view_dispatcher_switch_to_view(app->view_dispatcher, ESP32CamAIViewSettings);
 }
 
@@ -681,6 +1305,9 @@ static bool esp32_cam_ai_scene_settings_on_event(void* context, SceneManagerEven
         if(event.event == ESP32CamAIEventBack) {
             scene_manager_previous_scene(app->scene_manager);
             consumed = true;
+        } else if(event.event == ESP32CamAIEventCacheClearPressed) {
+            esp32_cam_ai_settings_clear_cache(app);
+            consumed = true;
         }
     }
     
@@ -696,6 +1323,7 @@ static bool esp32_cam_ai_scene_settings_on_event(void* context, SceneManagerEven
 static void esp32_cam_ai_scene_settings_on_exit(void* context) {
     ESP32CamAI* app = (ESP32CamAI*)context;
     variable_item_list_reset(app->variable_item_list);
+    esp32_cam_ai_settings_save(app);
 }
 
 // Scene handlers table
@@ -708,6 +1336,9 @@ void (*const esp32_cam_ai_scene_on_enter_handlers[])(void*) = {
     esp32_cam_ai_scene_text_input_on_enter,    // NUOVO
     esp32_cam_ai_scene_text_input_on_enter,    // Custom Chat usa stesso input
     esp32_cam_ai_scene_text_input_on_enter,    // Text Input handler
+    esp32_cam_ai_scene_preview_on_enter,
+    esp32_cam_ai_scene_viewfinder_on_enter,
+    esp32_cam_ai_scene_stats_on_enter,
 };
 
 bool (*const esp32_cam_ai_scene_on_event_handlers[])(void*, SceneManagerEvent) = {
@@ -719,6 +1350,9 @@ bool (*const esp32_cam_ai_scene_on_event_handlers[])(void*, SceneManagerEvent) =
     esp32_cam_ai_scene_text_input_on_event,    // NUOVO
     esp32_cam_ai_scene_text_input_on_event,    // Custom Chat
     esp32_cam_ai_scene_text_input_on_event,    // Text Input
+    esp32_cam_ai_scene_preview_on_event,
+    esp32_cam_ai_scene_viewfinder_on_event,
+    esp32_cam_ai_scene_stats_on_event,
 };
 
 void (*const esp32_cam_ai_scene_on_exit_handlers[])(void*) = {
@@ -730,6 +1364,9 @@ void (*const esp32_cam_ai_scene_on_exit_handlers[])(void*) = {
     esp32_cam_ai_scene_text_input_on_exit,     // NUOVO
     esp32_cam_ai_scene_text_input_on_exit,     // Custom Chat
     esp32_cam_ai_scene_text_input_on_exit,     // Text Input
+    esp32_cam_ai_scene_preview_on_exit,
+    esp32_cam_ai_scene_viewfinder_on_exit,
+    esp32_cam_ai_scene_stats_on_exit,
 };
 
 // Scene manager handlers
@@ -766,18 +1403,26 @@ static bool esp32_cam_ai_custom_event_callback(void* context, uint32_t event) {
 // App allocation and initialization
 static ESP32CamAI* esp32_cam_ai_app_alloc() {
     ESP32CamAI* app = malloc(sizeof(ESP32CamAI));
-    
-    // Initialize default values
-    app->baudrate = BAUDRATE;
-    app->uart_connected = false;
-    app->ptt_active = false;
-    app->flash_status = false;
-    app->response_updated = false;
-    app->is_vision_mode = false;  // NUOVO
+    app->launch_tick = furi_get_tick();
+    app->heap_free_start = memmgr_get_free_heap();
+    app->heap_block_start = memmgr_heap_get_max_free_block();
+    
+    // Settings, replaced by the saved ones if there are any
+    app->baudrate_requested = BAUDRATE;
+    app->baudrate_verified = BAUDRATE;
+    app->response_cap = RESPONSE_CAP_DEFAULT;
+    app->flow_window = FLOW_WINDOW_DEFAULT;
+    app->preview_dither = ESP32CamAIDitherDiffusion;
+    app->archive_enabled = false;
+    app->trace_mode = ESP32CamAITraceOff;
+    app->second_camera = false;
+    app->settings_cache_item = NULL;
     
     // Initialize input buffer
     memset(app->input_buffer, 0, sizeof(app->input_buffer));
     
+    esp32_cam_ai_settings_load(app);
+    
     // GUI
     app->gui = furi_record_open(RECORD_GUI);
     app->view_dispatcher = view_dispatcher_alloc();
@@ -791,8 +1436,11 @@ static ESP32CamAI* esp32_cam_ai_app_alloc() {
     app->submenu = submenu_alloc();
     view_dispatcher_add_view(app->view_dispatcher, ESP32CamAIViewSubmenu, submenu_get_view(app->submenu));
     
-    app->text_box_response = text_box_alloc();
-    view_dispatcher_add_view(app->view_dispatcher, ESP32CamAIViewResponse, text_box_get_view(app->text_box_response));
+    app->response_view = esp32_cam_ai_response_view_alloc();
+    view_dispatcher_add_view(app->view_dispatcher, ESP32CamAIViewResponse, app->response_view);
+    
+    app->preview_view = esp32_cam_ai_preview_view_alloc(app);
+    view_dispatcher_add_view(app->view_dispatcher, ESP32CamAIViewPreview, app->preview_view);
     
     app->popup_ptt = popup_alloc();
     view_dispatcher_add_view(app->view_dispatcher, ESP32CamAIViewPTT, popup_get_view(app->popup_ptt));
@@ -804,12 +1452,15 @@ static ESP32CamAI* esp32_cam_ai_app_alloc() {
     app->text_input = text_input_alloc();
     view_dispatcher_add_view(app->view_dispatcher, ESP32CamAIViewTextInput, text_input_get_view(app->text_input));
     
+    app->widget_stats = widget_alloc();
+    view_dispatcher_add_view(app->view_dispatcher, ESP32CamAIViewStats, widget_get_view(app->widget_stats));
+    
     // Notifications
     app->notifications = furi_record_open(RECORD_NOTIFICATION);
     
-    // Data
-    app->response_text = furi_string_alloc();
-    app->line_buffer = furi_string_alloc();
+    // Worker state, sized by the settings
+    esp32_cam_ai_worker_alloc(app);
+    app->stats_text = furi_string_alloc();
     
     return app;
 }
@@ -820,12 +1471,18 @@ static void esp32_cam_ai_app_free(ESP32CamAI* app) {
     // Deinitialize UART
     esp32_cam_ai_uart_deinit(app);
     
+    // Keep the last verified baud rate for the next session
+    esp32_cam_ai_settings_save(app);
+    
     // Free views
     view_dispatcher_remove_view(app->view_dispatcher, ESP32CamAIViewSubmenu);
     submenu_free(app->submenu);
     
     view_dispatcher_remove_view(app->view_dispatcher, ESP32CamAIViewResponse);
-    text_box_free(app->text_box_response);
+    view_free(app->response_view);
+    
+    view_dispatcher_remove_view(app->view_dispatcher, ESP32CamAIViewPreview);
+    view_free(app->preview_view);
     
     view_dispatcher_remove_view(app->view_dispatcher, ESP32CamAIViewPTT);
     popup_free(app->popup_ptt);
@@ -837,6 +1494,9 @@ static void esp32_cam_ai_app_free(ESP32CamAI* app) {
     view_dispatcher_remove_view(app->view_dispatcher, ESP32CamAIViewTextInput);
     text_input_free(app->text_input);
     
+    view_dispatcher_remove_view(app->view_dispatcher, ESP32CamAIViewStats);
+    widget_free(app->widget_stats);
+    
     // Free GUI
     scene_manager_free(app->scene_manager);
     view_dispatcher_free(app->view_dispatcher);
@@ -846,8 +1506,23 @@ static void esp32_cam_ai_app_free(ESP32CamAI* app) {
     furi_record_close(RECORD_NOTIFICATION);
     
     // Free data
-    furi_string_free(app->response_text);
-    furi_string_free(app->line_buffer);
+    size_t heap_free = memmgr_get_free_heap();
+    size_t arena_peak = 0;
+    for(size_t i = 0; i < COUNT_OF(app->requests); i++) {
+        arena_peak = MAX(arena_peak, app->requests[i].arena_peak);
+    }
+    FURI_LOG_I(
+        TAG,
+        "Heap: %u free (%u at start), %u lowest, %lu%% fragmented (%lu%% at start), arena peak %u/%u",
+        heap_free,
+        app->heap_free_start,
+        memmgr_get_minimum_free_heap(),
+        esp32_cam_ai_heap_fragmentation(heap_free, memmgr_heap_get_max_free_block()),
+        esp32_cam_ai_heap_fragmentation(app->heap_free_start, app->heap_block_start),
+        arena_peak,
+        app->request_arena_size);
+    esp32_cam_ai_worker_free(app);
+    furi_string_free(app->stats_text);
     
     free(app);
 }
@@ -859,7 +1534,14 @@ int32_t esp32_cam_ai_app(void* p) {
     ESP32CamAI* app = esp32_cam_ai_app_alloc();
     
     view_dispatcher_attach_to_gui(app->view_dispatcher, app->gui, ViewDispatcherTypeFullscreen);
-    scene_manager_next_scene(app->scene_manager, ESP32CamAISceneStart);
+    
+    // The link comes up on the worker while the menu is already usable.
+    // Connect & Start is only left for a retry when the UART was busy.
+    if(esp32_cam_ai_uart_init(app)) {
+        scene_manager_next_scene(app->scene_manager, ESP32CamAISceneMenu);
+    } else {
+        scene_manager_next_scene(app->scene_manager, ESP32CamAISceneStart);
+    }
     
     view_dispatcher_run(app->view_dispatcher);
     
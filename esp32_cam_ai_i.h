@@ -0,0 +1,686 @@
+#pragma once
+
+// Shared by the GUI in esp32_cam_ai.c and the UART worker in
+// esp32_cam_ai_worker.c: configuration, protocol state and the app struct.
+
+#include <furi.h>
+#include <furi_hal.h>
+#include <gui/gui.h>
+#include <gui/view_dispatcher.h>
+#include <gui/scene_manager.h>
+#include <gui/modules/submenu.h>
+#include <gui/modules/popup.h>
+#include <gui/modules/variable_item_list.h>
+#include <gui/modules/text_input.h>
+#include <gui/modules/widget.h>
+#include <notification/notification_messages.h>
+#include <storage/storage.h>
+#include <toolbox/saved_struct.h>
+
+#include "esp32_cam_ai_proto.h"
+
+#define TAG "ESP32CamAI"
+
+// UART Configuration matching ESP32-CAM firmware
+#define UART_CH (FuriHalSerialIdUsart)
+#define SECOND_UART_CH (FuriHalSerialIdLpuart)  // Optional second camera
+#define BAUDRATE (115200)
+
+// Faster rates are negotiated after READY and verified with a PING/PONG echo
+#define BAUD_REPLY_TIMEOUT_MS (500)
+#define BAUD_SWITCH_DELAY_MS (10)
+
+// Capability offers are answered right away, silence counts as a rejection
+#define LINK_STEP_TIMEOUT_MS (500)
+
+// At launch STATUS is repeated until the peer answers it or announces READY
+#define HANDSHAKE_TIMEOUT_MS (1000)
+#define HANDSHAKE_ATTEMPTS (5)
+
+// Persisted settings
+#define SETTINGS_PATH APP_DATA_PATH("settings.bin")
+#define SETTINGS_MAGIC (0xCA)
+#define SETTINGS_VERSION (6)
+
+// RX path sizing: DMA drains into the staging buffer, the worker reads the stream
+#define RX_STREAM_SIZE (1024)
+#define RX_STAGING_SIZE (128)
+#define RX_CHUNK_SIZE (256)
+#define FLOW_WINDOW_DEFAULT (768)       // Unconsumed bytes the peer may send, below RX_STREAM_SIZE
+
+// Commands are queued by the GUI and transmitted by the worker
+#define TX_COMMAND_SIZE (160)
+#define TX_QUEUE_SIZE (4)
+
+// Tagged requests: commands go out as "#<id>:<command>" and the peer echoes
+// the tag on every reply, so several can be in flight and finish in any order
+#define REQUEST_INFLIGHT_MAX (4)
+#define REQUEST_TIMEOUT_MS (30000)      // Vision answers round-trip through the cloud
+#define REQUEST_TAG_SIZE (8)            // "#255:" plus terminator
+#define REQUEST_ARENA_EXTRA (512)       // Per slot beyond response_cap: command lines, suffixes
+#define REQUEST_SECOND_SLOT (REQUEST_INFLIGHT_MAX + 1)  // Answer of the second camera
+
+// Answer cache for CUSTOM_CHAT questions, one file per answer plus an index
+#define CACHE_PATH APP_DATA_PATH("cache")
+#define CACHE_INDEX_PATH APP_DATA_PATH("cache/index.bin")
+#define CACHE_INDEX_MAGIC (0xCB)
+#define CACHE_INDEX_VERSION (1)
+#define CACHE_ENTRIES_MAX (48)          // Keeps probe sequences short
+#define CACHE_SIZE_MAX (64 * 1024)      // Answer bytes on the card
+#define CACHE_QUEUE_SIZE (4)
+
+// Capture archive
+#define ARCHIVE_PATH APP_DATA_PATH("captures")
+#define ARCHIVE_STREAM_SIZE (8192)      // Records between the worker and the archive thread
+#define ARCHIVE_BLOCK_SIZE (4096)       // SD write size, a whole number of sectors
+#define ARCHIVE_RECORD_HEADER_SIZE (3)  // [type][length LE16]
+#define ARCHIVE_CHUNK_SIZE (512)        // Answer text per record
+#define ARCHIVE_NAME_SIZE (32)
+#define ARCHIVE_JPEG_MAX (512 * 1024)
+
+// UART trace, written through the archive thread and replayed by the worker
+#define TRACE_PATH APP_DATA_PATH("trace.bin")
+#define TRACE_MAGIC ("ECT1")
+#define TRACE_MAGIC_SIZE (4)
+#define TRACE_RECORD_HEADER_SIZE (7)    // [kind][tick LE32][length LE16]
+#define TRACE_ANSWERS_MAX (4)           // Replayed answers not yet checked against the trace
+
+// Latency statistics, exported from the Stats scene with OK
+#define STATS_PATH APP_DATA_PATH("stats.csv")
+#define STATS_BOUNDS (24)
+#define STATS_BUCKETS (STATS_BOUNDS + 1)   // Last one is over the top bound
+
+// Streamed answers (CHUNK/END) are capped at a user selectable length
+#define RESPONSE_CAP_DEFAULT (4096)
+#define RESPONSE_CAP_MIN (1024)
+#define REQUEST_ARENA_HEADROOM (16384)  // Of the largest free heap block, left after the arenas
+
+// Response view layout (FontSecondary, scrollbar on the right)
+#define RESPONSE_VIEW_MAX_LINES (512)
+#define RESPONSE_VIEW_LINE_CHARS (64)
+#define RESPONSE_VIEW_ROWS (6)
+#define RESPONSE_VIEW_LINE_HEIGHT (10)
+#define RESPONSE_VIEW_TEXT_WIDTH (122)
+
+// Camera preview: up to 128x64, centered, decoded to 1-bpp XBM as it arrives
+#define PREVIEW_WIDTH (DITHER_WIDTH_MAX)
+#define PREVIEW_HEIGHT (64)
+#define PREVIEW_STRIDE (PREVIEW_WIDTH / 8)
+#define PREVIEW_FB_SIZE (PREVIEW_STRIDE * PREVIEW_HEIGHT)
+
+// Viewfinder pacing: the next frame is requested once 5/4 of the last round
+// trip has passed, which leaves about a fifth of the link for commands
+#define VIEWFINDER_MIN_INTERVAL_MS (50)
+#define VIEWFINDER_TIMEOUT_MS (2000)
+
+// Worker event log: fixed-size records in a ring, formatted only when the
+// UART stops. Per-line events are compiled in for debug builds only.
+#define EVENT_LOG_SIZE (64)             // Records, power of two
+#define EVENT_LOG_TEXT_SIZE (12)        // Leading bytes of a line kept with its event
+#ifdef FURI_DEBUG
+#define EVENT_LOG_VERBOSE (1)
+#else
+#define EVENT_LOG_VERBOSE (0)
+#endif
+
+// Minimum interval between response redraws while an answer streams in (~30 Hz)
+#define UI_REFRESH_INTERVAL_MS (33)
+
+// Application scenes
+typedef enum {
+    ESP32CamAISceneStart,
+    ESP32CamAISceneMenu,
+    ESP32CamAISceneResponse,
+    ESP32CamAIScenePTT,
+    ESP32CamAISceneSettings,
+    ESP32CamAISceneCustomVision,     // NUOVO
+    ESP32CamAISceneCustomChat,       // NUOVO
+    ESP32CamAISceneTextInput,        // NUOVO
+    ESP32CamAIScenePreview,
+    ESP32CamAISceneViewfinder,
+    ESP32CamAISceneStats,
+    ESP32CamAISceneCount,
+} ESP32CamAIScene;
+
+// Application views  
+typedef enum {
+    ESP32CamAIViewSubmenu,
+    ESP32CamAIViewResponse,
+    ESP32CamAIViewPTT,
+    ESP32CamAIViewSettings,
+    ESP32CamAIViewTextInput,         // NUOVO
+    ESP32CamAIViewPreview,
+    ESP32CamAIViewStats,
+} ESP32CamAIView;
+
+// Application events
+typedef enum {
+    ESP32CamAIEventStartPressed,
+    ESP32CamAIEventVisionPressed,
+    ESP32CamAIEventMathPressed,
+    ESP32CamAIEventOCRPressed,
+    ESP32CamAIEventCountPressed,
+    ESP32CamAIEventPTTPressed,
+    ESP32CamAIEventFlashOnPressed,
+    ESP32CamAIEventFlashOffPressed,
+    ESP32CamAIEventFlashTogglePressed,
+    ESP32CamAIEventStatusPressed,
+    ESP32CamAIEventSettingsPressed,
+    ESP32CamAIEventCustomVisionPressed,  // NUOVO
+    ESP32CamAIEventCustomChatPressed,    // NUOVO
+    ESP32CamAIEventTextInputDone,        // NUOVO
+    ESP32CamAIEventCacheClearPressed,
+    ESP32CamAIEventPreviewPressed,
+    ESP32CamAIEventPreviewOk,
+    ESP32CamAIEventViewfinderPressed,
+    ESP32CamAIEventStatsPressed,
+    ESP32CamAIEventStatsExport,
+    ESP32CamAIEventBack,
+    ESP32CamAIEventUpdateResponse,
+} ESP32CamAIEvent;
+
+// Worker thread flags
+typedef enum {
+    ESP32CamAIWorkerEventStop = (1 << 0),
+    ESP32CamAIWorkerEventRx = (1 << 1),
+    ESP32CamAIWorkerEventTx = (1 << 2),
+    ESP32CamAIWorkerEventBaud = (1 << 3),   // baudrate_requested changed
+    ESP32CamAIWorkerEventViewfinder = (1 << 4), // viewfinder_enabled changed
+    ESP32CamAIWorkerEventArchive = (1 << 5),    // archive_enabled changed
+    ESP32CamAIWorkerEventCache = (1 << 6),      // A slot came back from the cache thread
+} ESP32CamAIWorkerEvent;
+
+#define WORKER_EVENTS_ALL                                                        \
+    (ESP32CamAIWorkerEventStop | ESP32CamAIWorkerEventRx | ESP32CamAIWorkerEventTx | \
+     ESP32CamAIWorkerEventBaud | ESP32CamAIWorkerEventViewfinder | ESP32CamAIWorkerEventArchive | \
+     ESP32CamAIWorkerEventCache)
+
+// Startup handshake. Commands wait in the TX queue while it is running.
+typedef enum {
+    ESP32CamAIHandshakeWaiting,
+    ESP32CamAIHandshakeDone,
+    ESP32CamAIHandshakeFailed,          // Gave up; commands go out anyway
+} ESP32CamAIHandshake;
+
+// Baud rate negotiation: BAUD:<rate> -> BAUD:OK, both switch, PING -> PONG
+typedef enum {
+    ESP32CamAIBaudIdle,
+    ESP32CamAIBaudProposed,             // Waiting for BAUD:OK at the old rate
+    ESP32CamAIBaudVerifying,            // Switched, waiting for PONG at the new rate
+} ESP32CamAIBaudState;
+
+// Capability offers made after READY, one at a time, in this order
+typedef enum {
+    ESP32CamAILinkStepNone,
+    ESP32CamAILinkStepFlow,             // FLOW:<window> -> FLOW:OK or ERROR
+    ESP32CamAILinkStepFramed,           // FRAMED -> FRAMED:OK or ERROR
+    ESP32CamAILinkStepTags,             // TAGS -> TAGS:OK or ERROR
+    ESP32CamAILinkStepCompress,         // COMPRESS:LZ:<w>:<l> -> COMPRESS:OK or ERROR
+    ESP32CamAILinkStepArchive,          // ARCHIVE:ON|OFF -> ARCHIVE:OK or ERROR, also later on
+} ESP32CamAILinkStep;
+
+// Negotiated link mode as the worker publishes it for the GUI
+typedef enum {
+    ESP32CamAILinkModeFramed = (1 << 0),
+    ESP32CamAILinkModeTagged = (1 << 1),
+    ESP32CamAILinkModeCompressed = (1 << 2),
+    ESP32CamAILinkModeFlow = (1 << 3),
+} ESP32CamAILinkMode;
+
+// Settings stored on the SD card between sessions
+typedef struct {
+    uint32_t baudrate;                  // Last rate verified with the ESP32-CAM
+    uint32_t response_cap;
+    uint32_t preview_dither;
+    uint32_t archive;
+    uint32_t flow_window;
+    uint32_t trace;
+    uint32_t second_camera;
+} ESP32CamAISettings;
+
+// Commands with latency statistics, by line prefix
+typedef enum {
+    ESP32CamAIStatsVision,
+    ESP32CamAIStatsMath,
+    ESP32CamAIStatsOcr,
+    ESP32CamAIStatsCounting,
+    ESP32CamAIStatsCustomVision,
+    ESP32CamAIStatsCustomChat,
+    ESP32CamAIStatsCount,               // Also marks a request that is not timed
+} ESP32CamAIStatsCommand;
+
+extern const char* const esp32_cam_ai_stats_commands[ESP32CamAIStatsCount];
+
+// Stages of a command, each timed on its own
+typedef enum {
+    ESP32CamAIStatsQueue,               // Menu press to TX
+    ESP32CamAIStatsWait,                // TX to the first reply
+    ESP32CamAIStatsTransfer,            // First reply to the final one
+    ESP32CamAIStatsDisplay,             // Final reply to the view update showing it
+    ESP32CamAIStatsStageCount,
+} ESP32CamAIStatsStage;
+
+extern const char* const esp32_cam_ai_stats_stages[ESP32CamAIStatsStageCount];
+
+// Upper bucket bounds in ms, roughly 1-2-5 steps from a redraw to a slow answer
+extern const uint16_t esp32_cam_ai_stats_bounds[STATS_BOUNDS];
+
+// Latency histogram. Samples in buckets[i] took less than bounds[i] ms and
+// at least the bound before it.
+typedef struct {
+    uint32_t count;
+    uint32_t min_ms;
+    uint32_t max_ms;
+    uint32_t buckets[STATS_BUCKETS];
+} ESP32CamAIHistogram;
+
+// Worker events, see EVENT_LOG_SIZE
+typedef enum {
+    ESP32CamAILogRxLine,                // Verbose. text, length
+    ESP32CamAILogTxCommand,             // text, length
+    ESP32CamAILogAnswer,                // args: text bytes, wire bytes, ms
+    ESP32CamAILogUnknownFrame,          // args: frame type
+} ESP32CamAILogEvent;
+
+typedef struct {
+    uint32_t tick;
+    uint8_t event;
+    uint8_t tag;                        // Request tag, 0 if none
+    uint16_t length;                    // Of the whole line `text` starts
+    uint32_t args[3];
+    char text[EVENT_LOG_TEXT_SIZE];     // Not NUL-terminated
+} ESP32CamAILogRecord;
+
+// Command queued for transmission
+typedef struct {
+    char line[TX_COMMAND_SIZE];         // Without the trailing '\n'
+    size_t question_offset;             // Start of the question in CUSTOM_* commands, 0 otherwise
+    bool cacheable;                     // Looked up in and stored to the answer cache
+    bool cached;                        // Replay: stands in for an answer the cache gave
+    uint32_t queued_tick;               // When the GUI queued it
+} ESP32CamAICommand;
+
+typedef enum {
+    ESP32CamAICacheOpLookup,            // Read a stored answer into the slot on loan
+    ESP32CamAICacheOpStore,             // Write the answer of the slot on loan
+    ESP32CamAICacheOpClear,
+    ESP32CamAICacheOpStop,
+} ESP32CamAICacheOp;
+
+// Who may touch a request slot's arena. The worker lends a slot to the cache
+// thread for a lookup or store and nothing else writes to it until it is
+// back, so answers go between the card and the arena without copies.
+typedef enum {
+    ESP32CamAICacheLoanNone,            // Worker's
+    ESP32CamAICacheLoanLookup,          // Cache thread reads a stored answer into the text
+    ESP32CamAICacheLoanStore,           // Cache thread writes the text out, it must not change
+    ESP32CamAICacheLoanHit,             // Lookup back, the text is the answer
+    ESP32CamAICacheLoanMiss,            // Lookup back, the command still has to go out
+} ESP32CamAICacheLoan;
+
+// Capture archive records, written back to back into archive_stream. Files
+// are written one at a time: Open, any number of Data, Close. The trace file
+// is written alongside them by its own records.
+typedef enum {
+    ESP32CamAIArchiveOpen,              // File name under ARCHIVE_PATH
+    ESP32CamAIArchiveData,
+    ESP32CamAIArchiveClose,             // [keep], an incomplete file is removed
+    ESP32CamAIArchiveTraceOpen,         // Starts TRACE_PATH over
+    ESP32CamAIArchiveTrace,             // Bytes appended to the trace
+    ESP32CamAIArchiveTraceClose,
+    ESP32CamAIArchiveStop,
+} ESP32CamAIArchiveRecord;
+
+// UART trace session, chosen at launch
+typedef enum {
+    ESP32CamAITraceOff,
+    ESP32CamAITraceCapture,             // Record the session to TRACE_PATH
+    ESP32CamAITraceReplay,              // Feed TRACE_PATH to the worker with its original timing
+    ESP32CamAITraceReplayFast,          // Same, as fast as the worker goes
+    ESP32CamAITraceModeCount,
+} ESP32CamAITraceMode;
+
+// Trace records, after TRACE_MAGIC: [kind][tick LE32][length LE16][payload].
+// Ticks count from the start of the worker.
+typedef enum {
+    ESP32CamAITraceRx = 0x01,           // Block drained from rx_stream
+    ESP32CamAITraceTx = 0x02,           // As written to the UART, text lines without their '\n'
+    ESP32CamAITraceCommand = 0x03,      // Line of a command the GUI queued
+    ESP32CamAITraceCommandCached = 0x04,    // Same, answered from the cache
+    ESP32CamAITraceAnswer = 0x05,       // [tag][FNV-1a LE32] of a finished answer's text
+} ESP32CamAITraceKind;
+
+// File being written by the archive thread
+typedef struct {
+    File* file;
+    bool ok;                            // Opened and every write went through
+    uint8_t* block;                     // ARCHIVE_BLOCK_SIZE bytes
+    size_t fill;
+    uint32_t size;
+    uint32_t write_ticks;               // Spent in storage_file_write
+} ESP32CamAIArchiveWriter;
+
+// Pixel formats of PREVIEW:<width>:<height>:<format>
+typedef enum {
+    ESP32CamAIPreviewMono,              // 1 bpp, 1 is black, rows padded to whole bytes, MSB first
+    ESP32CamAIPreviewGray,              // 8 bpp
+} ESP32CamAIPreviewFormat;
+
+// Preview view model. The worker decodes into a back buffer and swaps it
+// with the front one here once a frame is complete.
+typedef struct {
+    uint8_t* framebuffer;               // Front buffer, XBM: rows of LSB-first bytes
+    bool valid;                         // Holds a complete frame
+    bool show_stats;
+    const char* status;                 // Shown in the bottom strip
+    uint8_t width;
+    uint8_t height;
+    uint32_t frame_id;                  // Peer's id of the frame on screen, 0 if none
+    
+    // Viewfinder counters, shown instead of the timings
+    bool viewfinder;
+    uint32_t fps_x10;
+    uint32_t dropped;
+    
+    uint32_t transfer_ms;               // PREVIEW: header to last pixel
+    uint32_t decode_us;                 // Time spent decoding pixels
+    uint32_t decode_cpp_x10;            // Decode cycles per pixel, times 10
+} ESP32CamAIPreviewViewModel;
+
+// Response text published by the worker for the GUI
+typedef struct {
+    FuriString* text;
+    uint32_t generation;
+    uint32_t change_tick;               // Tick of the oldest change it carries
+    ESP32CamAIStatsCommand stats_command;
+    uint32_t stats_final_tick;          // Final reply of a timed request, 0 if none
+} ESP32CamAIResponseSnapshot;
+
+// One request and its answer. Slot 0 takes untagged lines: everything from
+// peers without tag support, and unsolicited ones like READY.
+typedef struct {
+    uint8_t id;                         // Tag echoed by the peer, 0 for slot 0
+    bool pending;                       // Waiting for a final reply
+    uint32_t deadline;                  // Tick at which a pending request times out
+    uint32_t generation;                // Bumped when text is replaced, not appended
+    
+    // Arena of the slot: the answer text grows up from the bottom, command
+    // lines are bump-allocated down from the top
+    char* text;                         // Bottom of the arena, NUL-terminated
+    size_t text_size;
+    size_t arena_top;                   // Lowest allocated byte, request_arena_size if none
+    size_t arena_peak;                  // High-water mark since app start
+    
+    // Streamed answer state (CHUNK:<id>:<text> or LZ frames ... END:<id>)
+    uint32_t stream_id;
+    bool stream_active;
+    bool stream_truncated;
+    size_t stream_base;                 // Text size before the first fragment
+    uint32_t stream_start_tick;
+    uint32_t stream_wire_bytes;         // Payload bytes received, compressed or not
+    
+    ESP32CamAILz lz;                    // Decoder of a compressed answer
+    
+    // Latency statistics, Count while the request is not timed
+    ESP32CamAIStatsCommand stats_command;
+    uint32_t stats_sent_tick;
+    uint32_t stats_first_tick;          // First reply, 0 until it arrives
+    uint32_t stats_final_tick;          // Final reply, 0 until it arrives
+    
+    const char* cache_line;             // In the arena while a cacheable answer is pending
+    uint32_t cache_loan;                // ESP32CamAICacheLoan, handed over with __atomic
+    char archive_name[ARCHIVE_NAME_SIZE];   // Capture files to write, empty if not archived
+} ESP32CamAIRequest;
+
+typedef struct {
+    ESP32CamAICacheOp op;
+    ESP32CamAIRequest* request;         // Lookup, Store: slot on loan
+    const char* line;                   // Lookup, Store: command of the slot, in its arena
+    size_t answer_size;                 // Store: leading text bytes that are the answer
+} ESP32CamAICacheMessage;
+
+// Main application structure
+typedef struct ESP32CamAI ESP32CamAI;
+
+// One ESP32-CAM on one UART, up to the point where complete lines come out
+typedef struct {
+    ESP32CamAI* app;
+    FuriHalSerialId serial_id;
+    FuriHalSerialHandle* serial_handle;
+    bool receiving;                     // DMA RX is running
+    FuriStreamBuffer* rx_stream;
+    uint8_t rx_staging[RX_STAGING_SIZE];    // Only touched from the DMA RX ISR
+    char line_buffer[LINE_BUFFER_SIZE + 1]; // Partial line carried between reads
+    size_t line_length;
+    
+    // RX statistics, written from the DMA RX ISR
+    volatile uint32_t rx_bytes;
+    volatile uint32_t rx_dropped;           // Bytes lost because rx_stream was full
+    volatile uint32_t rx_overruns;          // Hardware overrun errors reported by the UART
+} ESP32CamAILink;
+
+struct ESP32CamAI {
+    Gui* gui;
+    ViewDispatcher* view_dispatcher;
+    SceneManager* scene_manager;
+    
+    // Views
+    Submenu* submenu;
+    View* response_view;
+    View* preview_view;
+    Popup* popup_ptt;
+    VariableItemList* variable_item_list;
+    VariableItem* settings_cache_item;  // Valid while the settings scene is shown
+    TextInput* text_input;              // NUOVO
+    
+    // UART. The main camera negotiates the full protocol; the second one
+    // stays on plain text lines at BAUDRATE and only takes broadcasts.
+    ESP32CamAILink main_link;
+    ESP32CamAILink second_link;
+    FuriThread* worker_thread;
+    FuriMessageQueue* tx_queue;
+    ESP32CamAICommand tx_command;       // Worker dequeue buffer
+    uint8_t tx_frame_raw[FRAME_RAW_MAX];
+    uint8_t tx_frame[FRAME_ENCODED_MAX];
+    
+    // Link mode, negotiated after READY. Worker only.
+    bool link_framed;
+    bool link_tagged;
+    bool link_compressed;               // Peer may send answers in LZ frames
+    bool link_flow;                     // Peer waits for credit, see flow_consumed
+    uint32_t link_mode;                 // ESP32CamAILinkMode bits of the above, for the GUI
+    ESP32CamAILinkStep link_step;
+    uint32_t link_step_deadline;        // Tick at which the offer counts as rejected
+    ESP32CamAIBaudState baud_state;
+    uint32_t baud_candidate;
+    uint32_t baud_deadline;             // Tick at which the current step times out
+    uint32_t frames_ok;
+    uint32_t frames_bad;                // Dropped on COBS, length or CRC errors
+    
+    // Credit flow control. After FLOW:OK the peer keeps what it sent within
+    // link_flow_window bytes of the last flow_consumed reported in CREDIT:.
+    uint32_t link_flow_window;          // Window the peer accepted
+    uint32_t flow_consumed;             // Bytes taken off rx_stream since FLOW:OK
+    uint32_t flow_credited;             // flow_consumed last sent in CREDIT:
+    volatile uint32_t flow_pauses;      // Credits sent with the peer's window used up
+    volatile uint32_t stream_text_rate; // Last streamed answer, text bytes/s
+    volatile uint32_t stream_wire_rate; // Same answer, bytes/s on the wire
+    
+    // Answer cache, owned by the cache thread while the UART runs
+    FuriThread* cache_thread;
+    FuriMessageQueue* cache_queue;
+    ESP32CamAICacheMessage cache_message;   // Cache thread dequeue buffer
+    ESP32CamAICacheIndex cache_index;
+    bool cache_index_dirty;
+    volatile uint32_t cache_hits;
+    volatile uint32_t cache_misses;
+    
+    // Capture archive. The worker queues records without ever waiting, the
+    // archive thread writes them out in ARCHIVE_BLOCK_SIZE blocks.
+    volatile bool archive_enabled;      // Setting, requested from the peer on framed links
+    bool link_archive;                  // Peer sends JPEG captures. Worker only.
+    bool link_archive_refused;          // ARCHIVE:ON rejected, retried after the setting goes off
+    FuriThread* archive_thread;         // Started by the worker once there is something to write
+    FuriStreamBuffer* archive_stream;   // Allocated with archive_thread
+    uint32_t archive_next;              // Capture counter for file names. Worker only.
+    bool archive_jpeg_active;           // Worker only, like the rest of the transfer state
+    uint32_t archive_jpeg_size;
+    uint32_t archive_jpeg_received;
+    volatile uint32_t archive_saved;    // Files written completely
+    volatile uint32_t archive_dropped;  // Files given up on: stream full, lost frame, SD error
+    volatile uint32_t archive_rate;     // SD write throughput of the last file, bytes/s
+    
+    // UART trace. trace_mode is the setting, trace_session what this launch does.
+    ESP32CamAITraceMode trace_mode;
+    ESP32CamAITraceMode trace_session;
+    bool trace_capturing;               // Worker only
+    bool trace_replaying;               // Worker only, set while the trace is fed in
+    uint32_t trace_start_tick;
+    uint32_t trace_answers[TRACE_ANSWERS_MAX];  // Hashes of replayed answers, oldest first
+    size_t trace_answer_count;
+    volatile uint32_t trace_bytes;      // Captured or replayed
+    volatile uint32_t trace_checked;    // Answers in the trace
+    volatile uint32_t trace_matched;    // Of those, replayed with the same text
+    volatile bool trace_cut;            // Capture ended early, archive_stream was full
+    
+    // Notifications
+    NotificationApp* notifications;
+    
+    // Requests in flight. Worker only, except while no worker runs.
+    ESP32CamAIRequest requests[REQUEST_SECOND_SLOT + 1];
+    ESP32CamAIRequest* request;         // Target of the line being handled
+    size_t request_focus;               // Slot shown in the response view
+    uint8_t request_next_id;
+    char* request_arenas;               // One block for the main link's slots, reserved at app start
+    size_t request_arena_size;          // Per slot, from the response_cap at app start
+    uint32_t response_generation;       // Source of request generations
+    
+    // Broadcast of a VISION or COUNT to both cameras. The second camera's
+    // answer is added below the main one once both are in. Worker only.
+    bool second_camera;                 // Setting, applies when the UART starts
+    bool broadcast_active;
+    size_t broadcast_slot;              // Request of the main camera
+    uint8_t broadcast_id;
+    bool broadcast_main_done;
+    uint32_t broadcast_tick;            // Sent to both
+    uint32_t broadcast_main_ms;
+    uint32_t broadcast_second_ms;
+    
+    // The worker fills response_snapshots[back] and publishes it, the GUI
+    // acquires the latest one as response_snapshots[front]
+    ESP32CamAIResponseSnapshot response_snapshots[3];
+    ESP32CamAITripleBuffer response_buffer;
+    // Preview transfer in progress. Worker only.
+    bool preview_active;
+    ESP32CamAIPreviewFormat preview_format;
+    uint8_t preview_width;
+    uint8_t preview_height;
+    uint32_t preview_size;              // Pixel bytes announced
+    uint32_t preview_received;          // Next expected offset
+    uint32_t preview_start_tick;
+    uint32_t preview_decode_cycles;
+    uint8_t preview_request_id;         // Request that gets the timing line
+    uint32_t preview_frame_id;
+    ESP32CamAIDither dither;
+    uint8_t preview_buffers[2][PREVIEW_FB_SIZE];
+    uint8_t* preview_back;              // Being decoded, the other one is on screen
+    
+    // Viewfinder. The GUI turns it on and off, the worker paces the frames.
+    volatile bool viewfinder_enabled;
+    bool viewfinder_running;
+    bool viewfinder_waiting;            // A PREVIEW request is outstanding
+    uint32_t viewfinder_request_tick;
+    uint32_t viewfinder_next_tick;
+    uint32_t viewfinder_window_tick;    // Start of the current FPS window
+    uint32_t viewfinder_window_frames;
+    uint32_t viewfinder_fps_x10;
+    uint32_t viewfinder_dropped;
+    
+    uint8_t rx_chunk[RX_CHUNK_SIZE];        // Worker block read buffer
+    char input_buffer[128];             // CORRETTO: buffer char array
+    bool uart_connected;
+    bool ptt_active;
+    bool flash_status;
+    bool is_vision_mode;                // NUOVO: distingue vision/chat
+    
+    // UI refresh coalescing, owned by the worker
+    bool ui_pending;                    // Change not yet posted to the view dispatcher
+    uint32_t ui_change_tick;            // Tick of the oldest unposted change
+    uint32_t ui_last_post_tick;
+    
+    // Latency statistics. The worker records the link stages and the GUI the
+    // display one; the Stats scene reads a copy taken under stats_mutex.
+    ESP32CamAIHistogram stats[ESP32CamAIStatsCount][ESP32CamAIStatsStageCount];
+    FuriMutex* stats_mutex;
+    Widget* widget_stats;
+    FuriString* stats_text;
+    
+    // Navigation state
+    uint32_t current_scene;
+    
+    // Settings
+    uint32_t baudrate;                  // Rate the link currently runs at
+    uint32_t baudrate_requested;        // From the selector, GUI only; atomic
+    uint32_t baudrate_target;           // Rate to negotiate, worker only
+    uint32_t baudrate_verified;         // Last rate the link kept, persisted; atomic
+    uint32_t response_cap;              // Selected answer cap in bytes, persisted
+    uint32_t response_cap_active;       // Cap in effect, never above the arenas'; atomic
+    uint32_t flow_window;               // RX high-water mark offered to the peer
+    ESP32CamAIDitherMode preview_dither;
+    
+    // RX path cost: splitting, decoding and handling what the worker drained
+    uint64_t parse_cycles;
+    uint32_t parse_bytes;
+    
+    // Event log, written by the worker and read once it has stopped
+    ESP32CamAILogRecord log[EVENT_LOG_SIZE];
+    uint32_t log_head;                  // Records ever written, the ring keeps the last ones
+    
+    // Worker wakeups since it started, and those that found nothing to do
+    uint32_t worker_start_tick;
+    volatile uint32_t worker_wakeups;
+    volatile uint32_t worker_idle_wakeups;
+    
+    // Startup, in ms since launch_tick, 0 until reached
+    uint32_t launch_tick;
+    ESP32CamAIHandshake handshake;      // Worker only
+    uint32_t handshake_deadline;
+    uint32_t handshake_attempts;
+    volatile uint32_t startup_ready_ms;     // Peer answered the handshake
+    volatile uint32_t startup_command_ms;   // First command sent to a ready peer
+    
+    // Heap state at app start, to compare against in the statistics
+    size_t heap_free_start;
+    size_t heap_block_start;            // Largest free block
+};
+
+// UART worker, esp32_cam_ai_worker.c
+void esp32_cam_ai_worker_alloc(ESP32CamAI* app);
+void esp32_cam_ai_worker_free(ESP32CamAI* app);
+bool esp32_cam_ai_uart_init(ESP32CamAI* app);
+void esp32_cam_ai_uart_deinit(ESP32CamAI* app);
+void esp32_cam_ai_uart_send_command(ESP32CamAI* app, const char* command);
+void esp32_cam_ai_uart_send_custom_command(ESP32CamAI* app, const char* prefix, const char* question);
+uint32_t esp32_cam_ai_link_mode(ESP32CamAI* app);
+uint32_t esp32_cam_ai_worker_wakeup_rate_x10(ESP32CamAI* app, uint32_t wakeups);
+uint32_t esp32_cam_ai_parse_cost_x10(ESP32CamAI* app);
+
+// Response text
+void esp32_cam_ai_arena_reset(ESP32CamAI* app, ESP32CamAIRequest* request);
+void esp32_cam_ai_response_set(ESP32CamAI* app, const char* format, ...);
+void esp32_cam_ai_response_publish(ESP32CamAI* app);
+uint32_t esp32_cam_ai_response_cap_apply(ESP32CamAI* app);
+const ESP32CamAIResponseSnapshot* esp32_cam_ai_response_acquire(ESP32CamAI* app);
+
+// Latency statistics
+void esp32_cam_ai_stats_record(
+    ESP32CamAI* app,
+    ESP32CamAIStatsCommand command,
+    ESP32CamAIStatsStage stage,
+    uint32_t ticks);
+uint32_t esp32_cam_ai_stats_percentile(const ESP32CamAIHistogram* histogram, uint32_t percent);
+bool esp32_cam_ai_stats_export(
+    const ESP32CamAIHistogram stats[ESP32CamAIStatsCount][ESP32CamAIStatsStageCount]);
+
+// Answer cache
+void esp32_cam_ai_cache_clear(ESP32CamAI* app, Storage* storage);
@@ -0,0 +1,442 @@
+#include "esp32_cam_ai_proto.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define PROTO_MIN(a, b) ((a) < (b) ? (a) : (b))
+
+// CRC-16/CCITT-FALSE, nibble table
+uint16_t esp32_cam_ai_crc16(const uint8_t* data, size_t size) {
+    static const uint16_t table[16] = {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+        0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    };
+    
+    uint16_t crc = 0xFFFF;
+    for(size_t i = 0; i < size; i++) {
+        crc = (crc << 4) ^ table[(crc >> 12) ^ (data[i] >> 4)];
+        crc = (crc << 4) ^ table[(crc >> 12) ^ (data[i] & 0x0F)];
+    }
+    return crc;
+}
+
+// COBS-encode into `out` (size + size / 254 + 1 bytes). Output bytes are
+// XORed with FRAME_DELIMITER so the delimiter never appears inside a frame.
+size_t esp32_cam_ai_cobs_encode(const uint8_t* data, size_t size, uint8_t* out) {
+    size_t code_pos = 0;
+    size_t out_pos = 1;
+    uint8_t code = 1;
+    
+    for(size_t i = 0; i < size; i++) {
+        if(data[i] == 0) {
+            out[code_pos] = code ^ FRAME_DELIMITER;
+            code_pos = out_pos++;
+            code = 1;
+        } else {
+            out[out_pos++] = data[i] ^ FRAME_DELIMITER;
+            if(++code == 0xFF) {
+                out[code_pos] = code ^ FRAME_DELIMITER;
+                code_pos = out_pos++;
+                code = 1;
+            }
+        }
+    }
+    out[code_pos] = code ^ FRAME_DELIMITER;
+    return out_pos;
+}
+
+// Decode a COBS block in place, delimiter already stripped. Returns 0 if malformed.
+size_t esp32_cam_ai_cobs_decode(uint8_t* data, size_t size) {
+    size_t in = 0;
+    size_t out = 0;
+    
+    while(in < size) {
+        uint8_t code = data[in++] ^ FRAME_DELIMITER;
+        if(code == 0 || in + code - 1 > size) return 0;
+        
+        for(uint8_t i = 1; i < code; i++) {
+            data[out++] = data[in++] ^ FRAME_DELIMITER;
+        }
+        if(code != 0xFF && in < size) data[out++] = 0;
+    }
+    return out;
+}
+
+// Build a complete frame, delimiter included, into `out` (FRAME_ENCODED_MAX
+// bytes) by way of `raw` (FRAME_RAW_MAX bytes). Returns 0 if the payload is
+// too long for a frame.
+size_t esp32_cam_ai_frame_encode(
+    ESP32CamAIFrameType type,
+    const uint8_t* payload,
+    size_t size,
+    uint8_t* raw,
+    uint8_t* out) {
+    if(size > FRAME_PAYLOAD_MAX) return 0;
+    
+    raw[0] = type;
+    raw[1] = size & 0xFF;
+    raw[2] = size >> 8;
+    memcpy(raw + FRAME_HEADER_SIZE, payload, size);
+    
+    size_t length = FRAME_HEADER_SIZE + size;
+    uint16_t crc = esp32_cam_ai_crc16(raw, length);
+    raw[length++] = crc & 0xFF;
+    raw[length++] = crc >> 8;
+    
+    size_t encoded = esp32_cam_ai_cobs_encode(raw, length, out);
+    out[encoded++] = FRAME_DELIMITER;
+    return encoded;
+}
+
+// Decode a received frame in place, delimiter already stripped, and check its
+// length and CRC. The payload then starts at data + FRAME_HEADER_SIZE, with
+// room for a terminator after it.
+bool esp32_cam_ai_frame_decode(uint8_t* data, size_t size, size_t* payload_length) {
+    size_t length = esp32_cam_ai_cobs_decode(data, size);
+    if(length < FRAME_HEADER_SIZE + FRAME_CRC_SIZE) return false;
+    
+    size_t payload = data[1] | (data[2] << 8);
+    if(payload != length - FRAME_HEADER_SIZE - FRAME_CRC_SIZE ||
+       esp32_cam_ai_crc16(data, length - FRAME_CRC_SIZE) !=
+           (data[length - 2] | (data[length - 1] << 8))) {
+        return false;
+    }
+    *payload_length = payload;
+    return true;
+}
+
+// Find the end of the current line, NULL if it continues. Frames may contain
+// '\r', so only text mode also splits on it.
+static const uint8_t* esp32_cam_ai_find_eol(bool framed, const uint8_t* data, size_t size) {
+    const uint8_t* lf = memchr(data, '\n', size);
+    if(framed) return lf;
+    
+    const uint8_t* cr = memchr(data, '\r', lf ? (size_t)(lf - data) : size);
+    return cr ? cr : lf;
+}
+
+// Move received bytes up to and including the next line end into `line`
+// (LINE_BUFFER_SIZE + 1 bytes), after the `line_length` bytes carried over.
+// Overlong lines are truncated. Sets `complete` and NUL-terminates the line
+// once its end was seen; returns the bytes of `data` taken.
+size_t esp32_cam_ai_line_take(
+    char* line,
+    size_t* line_length,
+    bool framed,
+    const uint8_t* data,
+    size_t size,
+    bool* complete) {
+    const uint8_t* eol = esp32_cam_ai_find_eol(framed, data, size);
+    size_t segment = eol ? (size_t)(eol - data) : size;
+    
+    size_t copy = PROTO_MIN(segment, LINE_BUFFER_SIZE - *line_length);
+    memcpy(line + *line_length, data, copy);
+    *line_length += copy;
+    
+    *complete = eol != NULL;
+    if(!eol) return segment;
+    
+    line[*line_length] = '\0';
+    return segment + 1;
+}
+
+#define REPLY(token, final, name) {token, sizeof(token) - 1, final},
+
+const ESP32CamAIReply esp32_cam_ai_replies[] = {ESP32_CAM_AI_REPLIES(REPLY)};
+const size_t esp32_cam_ai_reply_count = sizeof(esp32_cam_ai_replies) / sizeof(esp32_cam_ai_replies[0]);
+
+// Open addressing index over the table: slot holds table position + 1, 0 is empty
+#define REPLY_INDEX_SIZE (32)
+static uint8_t esp32_cam_ai_reply_index[REPLY_INDEX_SIZE];
+
+static uint32_t esp32_cam_ai_reply_hash(const char* token, size_t length) {
+    return ((uint32_t)length * 7 + (uint8_t)token[0] * 3 + (uint8_t)token[length - 1]) &
+           (REPLY_INDEX_SIZE - 1);
+}
+
+void esp32_cam_ai_reply_index_build(void) {
+    memset(esp32_cam_ai_reply_index, 0, sizeof(esp32_cam_ai_reply_index));
+    for(size_t i = 0; i < esp32_cam_ai_reply_count; i++) {
+        const ESP32CamAIReply* reply = &esp32_cam_ai_replies[i];
+        uint32_t slot = esp32_cam_ai_reply_hash(reply->token, reply->token_length);
+        while(esp32_cam_ai_reply_index[slot]) {
+            slot = (slot + 1) & (REPLY_INDEX_SIZE - 1);
+        }
+        esp32_cam_ai_reply_index[slot] = i + 1;
+    }
+}
+
+// Row of the reply with this token, ESP32_CAM_AI_REPLY_NONE if there is none
+size_t esp32_cam_ai_reply_find(const char* token, size_t length) {
+    if(length == 0) return ESP32_CAM_AI_REPLY_NONE;
+    
+    uint32_t slot = esp32_cam_ai_reply_hash(token, length);
+    while(esp32_cam_ai_reply_index[slot]) {
+        size_t row = esp32_cam_ai_reply_index[slot] - 1;
+        const ESP32CamAIReply* reply = &esp32_cam_ai_replies[row];
+        if(reply->token_length == length && memcmp(reply->token, token, length) == 0) {
+            return row;
+        }
+        slot = (slot + 1) & (REPLY_INDEX_SIZE - 1);
+    }
+    return ESP32_CAM_AI_REPLY_NONE;
+}
+
+// Strip a "#<id>:" tag off a line. Returns the rest of the line, all of it
+// if it carries no tag.
+const char* esp32_cam_ai_line_untag(const char* line, bool* tagged, uint32_t* id) {
+    *tagged = false;
+    *id = 0;
+    if(line[0] != '#') return line;
+    
+    char* end;
+    uint32_t value = strtoul(line + 1, &end, 10);
+    if(end == line + 1 || *end != ':') return line;
+    
+    *tagged = true;
+    *id = value;
+    return end + 1;
+}
+
+// Match the leading token of an untagged line. Only the token is looked at,
+// so answer text mentioning e.g. "ERROR:" is never misrouted. `arg` gets the
+// text after the first ':', or "" if there is none.
+size_t esp32_cam_ai_reply_match(const char* line, const char** arg) {
+    const char* colon = strchr(line, ':');
+    size_t token_length = colon ? (size_t)(colon - line) : strlen(line);
+    *arg = colon ? colon + 1 : "";
+    return esp32_cam_ai_reply_find(line, token_length);
+}
+
+// Decode LZ bits into `text`, after the `text_size` bytes already there, up
+// to `capacity` bytes; `text` has room for a terminator after that. Tokens
+// are MSB first: 1 + 8-bit literal, or 0 + window offset - 1 + length - 1,
+// copied from the text decoded since `base`. Tokens may span frames;
+// trailing pad bits never form one.
+ESP32CamAILzResult esp32_cam_ai_lz_decode(
+    ESP32CamAILz* lz,
+    const uint8_t* data,
+    size_t size,
+    char* text,
+    size_t* text_size,
+    size_t base,
+    size_t capacity) {
+    ESP32CamAILzResult result = ESP32CamAILzOk;
+    size_t length = *text_size;
+    
+    for(size_t i = 0; i < size && result == ESP32CamAILzOk; i++) {
+        lz->bits = (lz->bits << 8) | data[i];
+        lz->bit_count += 8;
+        
+        while(lz->bit_count > 0) {
+            bool literal = (lz->bits >> (lz->bit_count - 1)) & 1;
+            uint32_t bits = literal ? 8 : LZ_WINDOW_BITS + LZ_LENGTH_BITS;
+            if(lz->bit_count < 1 + bits) break;
+            
+            lz->bit_count -= 1 + bits;
+            uint32_t token = (lz->bits >> lz->bit_count) & ((1 << bits) - 1);
+            if(literal) {
+                if(length >= capacity) {
+                    result = ESP32CamAILzFull;
+                    break;
+                }
+                text[length++] = (char)token;
+                continue;
+            }
+            
+            size_t offset = (token >> LZ_LENGTH_BITS) + 1;
+            size_t count = (token & ((1 << LZ_LENGTH_BITS) - 1)) + 1;
+            if(offset > length - base) {
+                result = ESP32CamAILzCorrupt;
+                break;
+            }
+            for(; count > 0 && length < capacity; count--) {
+                text[length] = text[length - offset];
+                length++;
+            }
+            if(count > 0) {
+                result = ESP32CamAILzFull;
+                break;
+            }
+        }
+    }
+    
+    text[length] = '\0';
+    *text_size = length;
+    return result;
+}
+
+// Dithering. Pixels are converted in runs as they stream in, straight into
+// XBM rows, so no grayscale row is ever buffered. Integer math only.
+static const uint8_t esp32_cam_ai_bayer4[4][4] = {
+    {0, 8, 2, 10},
+    {12, 4, 14, 6},
+    {3, 11, 1, 9},
+    {15, 7, 13, 5},
+};
+
+void esp32_cam_ai_dither_begin(ESP32CamAIDither* dither, ESP32CamAIDitherMode mode) {
+    dither->mode = mode;
+    dither->carry = 0;
+    dither->current = 0;
+    memset(dither->error, 0, sizeof(dither->error));
+}
+
+// Convert `count` gray pixels starting at (column, row) of the source and set
+// the black ones in `line`, `x0` pixels from its left edge
+void esp32_cam_ai_dither_run(
+    ESP32CamAIDither* dither,
+    const uint8_t* gray,
+    size_t count,
+    uint32_t row,
+    uint32_t column,
+    uint8_t* line,
+    uint32_t x0) {
+    switch(dither->mode) {
+        case ESP32CamAIDitherBayer: {
+            const uint8_t* thresholds = esp32_cam_ai_bayer4[row & 3];
+            for(size_t i = 0; i < count; i++) {
+                uint32_t x = column + i;
+                if(gray[i] < thresholds[x & 3] * 16 + 8) {
+                    line[(x0 + x) >> 3] |= 1 << ((x0 + x) & 7);
+                }
+            }
+            break;
+        }
+        case ESP32CamAIDitherDiffusion: {
+            if(column == 0) {
+                // New row: what was "next" becomes current, the old row is reused
+                if(row > 0) dither->current ^= 1;
+                dither->carry = 0;
+                memset(dither->error[dither->current ^ 1], 0, sizeof(dither->error[0]));
+            }
+            int16_t* current = dither->error[dither->current];
+            int16_t* next = dither->error[dither->current ^ 1];
+            int32_t carry = dither->carry;
+            
+            for(size_t i = 0; i < count; i++) {
+                uint32_t x = column + i;
+                int32_t value = gray[i] + ((current[x + 1] + carry) >> 4);
+                int32_t error = value;
+                if(value < DITHER_THRESHOLD) {
+                    line[(x0 + x) >> 3] |= 1 << ((x0 + x) & 7);
+                } else {
+                    error -= 255;
+                }
+                carry = error * 7;
+                next[x] += error * 3;
+                next[x + 1] += error * 5;
+                next[x + 2] += error;
+            }
+            dither->carry = carry;
+            break;
+        }
+        default:
+            for(size_t i = 0; i < count; i++) {
+                uint32_t x = x0 + column + i;
+                if(gray[i] < DITHER_THRESHOLD) line[x >> 3] |= 1 << (x & 7);
+            }
+            break;
+    }
+}
+
+uint32_t esp32_cam_ai_fnv1a(const char* data, size_t size) {
+    uint32_t hash = 2166136261UL;
+    
+    for(size_t i = 0; i < size; i++) {
+        hash = (hash ^ (uint8_t)data[i]) * 16777619UL;
+    }
+    return hash;
+}
+
+// Cache key: the command lowercased, with whitespace runs collapsed and
+// trimmed, cut to `size` - 1 bytes. Returns its length.
+size_t esp32_cam_ai_cache_key(char* key, size_t size, const char* line) {
+    size_t length = 0;
+    bool space = false;
+    
+    for(; *line && length + 1 < size; line++) {
+        char c = *line;
+        if(c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            space = length > 0;
+            continue;
+        }
+        if(space && key[length - 1] != ':') {
+            key[length++] = ' ';
+            if(length + 1 >= size) break;
+        }
+        space = false;
+        key[length++] = (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+    }
+    key[length] = '\0';
+    return length;
+}
+
+// FNV-1a, never 0 so 0 can mark free index slots
+uint32_t esp32_cam_ai_cache_hash(const char* key, size_t length) {
+    uint32_t hash = esp32_cam_ai_fnv1a(key, length);
+    return hash ? hash : 1;
+}
+
+// Slot holding `hash`, or the free slot it would go to
+size_t esp32_cam_ai_cache_slot(const ESP32CamAICacheIndex* index, uint32_t hash) {
+    size_t slot = hash & (CACHE_SLOTS - 1);
+    while(index->entries[slot].hash && index->entries[slot].hash != hash) {
+        slot = (slot + 1) & (CACHE_SLOTS - 1);
+    }
+    return slot;
+}
+
+// Drop an entry. Backward shift deletion keeps every probe sequence unbroken
+// without tombstones.
+void esp32_cam_ai_cache_index_remove(ESP32CamAICacheIndex* index, size_t slot) {
+    index->total_size -= index->entries[slot].size;
+    index->count--;
+    
+    size_t hole = slot;
+    for(size_t next = (hole + 1) & (CACHE_SLOTS - 1); index->entries[next].hash;
+        next = (next + 1) & (CACHE_SLOTS - 1)) {
+        size_t home = index->entries[next].hash & (CACHE_SLOTS - 1);
+        if(((next - home) & (CACHE_SLOTS - 1)) >= ((next - hole) & (CACHE_SLOTS - 1))) {
+            index->entries[hole] = index->entries[next];
+            hole = next;
+        }
+    }
+    memset(&index->entries[hole], 0, sizeof(ESP32CamAICacheEntry));
+}
+
+// Least recently used entry, CACHE_SLOTS if the index is empty
+size_t esp32_cam_ai_cache_index_oldest(const ESP32CamAICacheIndex* index) {
+    size_t oldest = CACHE_SLOTS;
+    
+    for(size_t i = 0; i < CACHE_SLOTS; i++) {
+        if(!index->entries[i].hash) continue;
+        if(oldest == CACHE_SLOTS || index->clock - index->entries[i].last_used >
+                                        index->clock - index->entries[oldest].last_used) {
+            oldest = i;
+        }
+    }
+    return oldest;
+}
+
+void esp32_cam_ai_triple_init(ESP32CamAITripleBuffer* buffer) {
+    buffer->front = 0;
+    buffer->middle = 1;
+    buffer->back = 2;
+}
+
+// Hand buffer `back` to the consumer and take the one it left for the next fill
+void esp32_cam_ai_triple_publish(ESP32CamAITripleBuffer* buffer) {
+    buffer->back =
+        __atomic_exchange_n(&buffer->middle, buffer->back | TRIPLE_BUFFER_FRESH, __ATOMIC_ACQ_REL) &
+        TRIPLE_BUFFER_INDEX;
+}
+
+// Swap the latest published buffer into `front`, returns whether there was one
+bool esp32_cam_ai_triple_acquire(ESP32CamAITripleBuffer* buffer) {
+    if(!(__atomic_load_n(&buffer->middle, __ATOMIC_ACQUIRE) & TRIPLE_BUFFER_FRESH)) return false;
+    
+    buffer->front =
+        __atomic_exchange_n(&buffer->middle, buffer->front, __ATOMIC_ACQ_REL) & TRIPLE_BUFFER_INDEX;
+    return true;
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+// Wire protocol and data structure code of the ESP32-CAM AI app. Nothing in
+// here touches furi, so the same file builds into the app and into the host
+// tests and benchmarks under tests/.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Longest line the framer keeps, text or framed
+#define LINE_BUFFER_SIZE (512)
+
+// Framed link: [type][length LE16][payload][CRC16 LE], COBS-encoded with '\n'
+// as the delimiter so frames and text lines share the same line framer
+#define FRAME_DELIMITER ('\n')
+#define FRAME_HEADER_SIZE (3)
+#define FRAME_CRC_SIZE (2)
+#define FRAME_PAYLOAD_MAX (496)
+#define FRAME_RAW_MAX (FRAME_HEADER_SIZE + FRAME_PAYLOAD_MAX + FRAME_CRC_SIZE)
+#define FRAME_ENCODED_MAX (FRAME_RAW_MAX + FRAME_RAW_MAX / 254 + 2)
+
+// Compressed answers: heatshrink-style LZSS, window and length in bits
+#define LZ_WINDOW_BITS (10)
+#define LZ_LENGTH_BITS (5)
+#define LZ_FRAME_HEADER_SIZE (9)        // [tag][stream id LE32][offset LE32]
+
+// Answer cache index
+#define CACHE_SLOTS (64)                // Open addressing, power of two
+
+// Grayscale to 1-bpp conversion
+#define DITHER_WIDTH_MAX (128)
+#define DITHER_THRESHOLD (128)          // Grayscale pixels below this are black
+
+// Frame types of the framed link
+typedef enum {
+    ESP32CamAIFrameText = 0x01,         // One line of the text protocol, may contain '\n'
+    ESP32CamAIFrameImage = 0x02,        // [offset LE16][pixels] of the preview announced by PREVIEW:
+    ESP32CamAIFrameJpeg = 0x03,         // [offset LE32][bytes] of the capture announced by JPEG:
+    ESP32CamAIFrameLz = 0x04,           // [tag][stream id LE32][offset LE32][LZ bits], END:<id> ends it
+} ESP32CamAIFrameType;
+
+// Replies of the peer, by the token before the first ':' of a line, and
+// whether they complete the request they are tagged with. The app keys its
+// handlers off this list, so adding a reply only takes a new row here.
+#define ESP32_CAM_AI_REPLIES(X)         \
+    X("READY", false, ready)            \
+    X("RECORDING", false, recording)    \
+    X("PROCESSING", false, processing)  \
+    X("FLASH", true, flash)             \
+    X("OK", true, ok)                   \
+    X("ERROR", true, error)             \
+    X("VOICE_RECOGNIZED", false, voice) \
+    X("STATUS", true, status)           \
+    X("CHUNK", false, chunk)            \
+    X("END", true, end)                 \
+    X("FLOW", false, flow)              \
+    X("FRAMED", false, framed)          \
+    X("TAGS", false, tags)              \
+    X("COMPRESS", false, compress)      \
+    X("BAUD", false, baud)              \
+    X("PONG", false, pong)              \
+    X("PREVIEW", true, preview)         \
+    X("ARCHIVE", false, archive)        \
+    X("JPEG", false, jpeg)
+
+typedef struct {
+    const char* token;
+    uint8_t token_length;
+    bool final;                         // Completes the request it is tagged with
+} ESP32CamAIReply;
+
+#define ESP32_CAM_AI_REPLY_NONE ((size_t)-1)
+
+extern const ESP32CamAIReply esp32_cam_ai_replies[];
+extern const size_t esp32_cam_ai_reply_count;
+
+// Answer cache index entry
+typedef struct {
+    uint32_t hash;                      // FNV-1a of the cache key, 0 marks a free slot
+    uint32_t size;                      // Answer file size in bytes
+    uint32_t last_used;                 // Cache clock at the last store or hit
+} ESP32CamAICacheEntry;
+
+// Answer cache index, kept in RAM by the cache thread and saved with the answers
+typedef struct {
+    uint32_t clock;
+    uint32_t count;
+    uint32_t total_size;
+    ESP32CamAICacheEntry entries[CACHE_SLOTS];
+} ESP32CamAICacheIndex;
+
+// LZ decoder state carried between frames. The decoded text itself is the
+// window, so this is all of it.
+typedef struct {
+    uint32_t bits;                      // Input bits not decoded yet, the last bit_count
+    uint8_t bit_count;
+} ESP32CamAILz;
+
+typedef enum {
+    ESP32CamAILzOk,                     // All input taken, a token may continue in the next frame
+    ESP32CamAILzFull,                   // The text reached its capacity
+    ESP32CamAILzCorrupt,                // A match reached before the start of the answer
+} ESP32CamAILzResult;
+
+// Grayscale to 1-bpp conversion of preview pixels
+typedef enum {
+    ESP32CamAIDitherThreshold,
+    ESP32CamAIDitherBayer,              // Ordered, 4x4 matrix
+    ESP32CamAIDitherDiffusion,          // Floyd-Steinberg, errors in 1/16 pixel units
+    ESP32CamAIDitherCount,
+} ESP32CamAIDitherMode;
+
+// Dithering state carried between runs of a streamed frame
+typedef struct {
+    ESP32CamAIDitherMode mode;
+    int16_t carry;                      // Error pushed to the next pixel in the row
+    uint8_t current;                    // Row of `error` the current row reads
+    int16_t error[2][DITHER_WIDTH_MAX + 2]; // Indexed x + 1 so x - 1 and x + 1 stay in range
+} ESP32CamAIDither;
+
+// Lock-free triple buffer between one producer and one consumer. The producer
+// fills buffer `back` and publishes it, the consumer acquires the latest one
+// as `front`; neither ever waits, and neither sees a buffer the other uses.
+#define TRIPLE_BUFFER_INDEX (0x3)
+#define TRIPLE_BUFFER_FRESH (0x4)
+
+typedef struct {
+    uint32_t back;                      // Producer only
+    uint32_t front;                     // Consumer only
+    uint32_t middle;                    // Shared: index | TRIPLE_BUFFER_FRESH
+} ESP32CamAITripleBuffer;
+
+// Framing
+uint16_t esp32_cam_ai_crc16(const uint8_t* data, size_t size);
+size_t esp32_cam_ai_cobs_encode(const uint8_t* data, size_t size, uint8_t* out);
+size_t esp32_cam_ai_cobs_decode(uint8_t* data, size_t size);
+size_t esp32_cam_ai_frame_encode(
+    ESP32CamAIFrameType type,
+    const uint8_t* payload,
+    size_t size,
+    uint8_t* raw,
+    uint8_t* out);
+bool esp32_cam_ai_frame_decode(uint8_t* data, size_t size, size_t* payload_length);
+size_t esp32_cam_ai_line_take(
+    char* line,
+    size_t* line_length,
+    bool framed,
+    const uint8_t* data,
+    size_t size,
+    bool* complete);
+
+// Replies
+void esp32_cam_ai_reply_index_build(void);
+size_t esp32_cam_ai_reply_find(const char* token, size_t length);
+const char* esp32_cam_ai_line_untag(const char* line, bool* tagged, uint32_t* id);
+size_t esp32_cam_ai_reply_match(const char* line, const char** arg);
+
+// Compressed answers
+ESP32CamAILzResult esp32_cam_ai_lz_decode(
+    ESP32CamAILz* lz,
+    const uint8_t* data,
+    size_t size,
+    char* text,
+    size_t* text_size,
+    size_t base,
+    size_t capacity);
+
+// Preview
+void esp32_cam_ai_dither_begin(ESP32CamAIDither* dither, ESP32CamAIDitherMode mode);
+void esp32_cam_ai_dither_run(
+    ESP32CamAIDither* dither,
+    const uint8_t* gray,
+    size_t count,
+    uint32_t row,
+    uint32_t column,
+    uint8_t* line,
+    uint32_t x0);
+
+// Answer cache
+uint32_t esp32_cam_ai_fnv1a(const char* data, size_t size);
+size_t esp32_cam_ai_cache_key(char* key, size_t size, const char* line);
+uint32_t esp32_cam_ai_cache_hash(const char* key, size_t length);
+size_t esp32_cam_ai_cache_slot(const ESP32CamAICacheIndex* index, uint32_t hash);
+void esp32_cam_ai_cache_index_remove(ESP32CamAICacheIndex* index, size_t slot);
+size_t esp32_cam_ai_cache_index_oldest(const ESP32CamAICacheIndex* index);
+
+// Response handoff
+void esp32_cam_ai_triple_init(ESP32CamAITripleBuffer* buffer);
+void esp32_cam_ai_triple_publish(ESP32CamAITripleBuffer* buffer);
+bool esp32_cam_ai_triple_acquire(ESP32CamAITripleBuffer* buffer);
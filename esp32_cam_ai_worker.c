@@ -0,0 +1,2902 @@
+// UART worker: link bring-up and negotiation, requests and their answers,
+// the answer cache, capture archive and trace. Everything here runs against
+// furi primitives and the serial HAL only, so tests/ builds it on the host.
+
+#include "esp32_cam_ai_i.h"
+
+// Request arenas. Each slot's arena is carved from one block reserved at app
+// start, so answers and command lines never allocate from the shared heap.
+// The second camera's slot gets its own once that camera is brought up.
+// Starting the next request in a slot resets its arena in O(1).
+
+static void esp32_cam_ai_arena_update_peak(ESP32CamAI* app, ESP32CamAIRequest* request) {
+    size_t used = app->request_arena_size - request->arena_top + request->text_size + 1;
+    if(used > request->arena_peak) request->arena_peak = used;
+}
+
+void esp32_cam_ai_arena_reset(ESP32CamAI* app, ESP32CamAIRequest* request) {
+    request->arena_top = app->request_arena_size;
+    request->text_size = 0;
+    request->text[0] = '\0';
+}
+
+// Format a string into the top of the arena, NULL if the text left no room
+static char* esp32_cam_ai_arena_printf(
+    ESP32CamAI* app,
+    ESP32CamAIRequest* request,
+    const char* format,
+    ...) {
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if(length < 0 || (size_t)length + 1 > request->arena_top - request->text_size - 1) return NULL;
+    
+    request->arena_top -= length + 1;
+    char* string = request->text + request->arena_top;
+    va_start(args, format);
+    vsnprintf(string, length + 1, format, args);
+    va_end(args);
+    esp32_cam_ai_arena_update_peak(app, request);
+    return string;
+}
+
+// Bytes the answer text can still grow by
+static size_t esp32_cam_ai_text_room(const ESP32CamAIRequest* request) {
+    return request->arena_top - request->text_size - 1;
+}
+
+// Drop a UTF-8 sequence left incomplete at the end of the text, never
+// cutting below `floor`
+static void esp32_cam_ai_text_trim_utf8(ESP32CamAIRequest* request, size_t floor) {
+    const uint8_t* text = (const uint8_t*)request->text;
+    size_t size = request->text_size;
+    size_t lead = size;
+    while(lead > floor && size - lead < 4 && (text[lead - 1] & 0xC0) == 0x80) lead--;
+    
+    if(lead > floor && text[lead - 1] >= 0xC0) {
+        size_t expected = text[lead - 1] >= 0xF0 ? 4 : text[lead - 1] >= 0xE0 ? 3 : 2;
+        if(size - (lead - 1) < expected) {
+            request->text_size = lead - 1;
+            request->text[request->text_size] = '\0';
+        }
+    }
+}
+
+// Append as much of `data` as fits, returns whether all of it did
+static bool esp32_cam_ai_text_append(
+    ESP32CamAI* app,
+    ESP32CamAIRequest* request,
+    const char* data,
+    size_t length) {
+    size_t copy = MIN(length, esp32_cam_ai_text_room(request));
+    memcpy(request->text + request->text_size, data, copy);
+    request->text_size += copy;
+    request->text[request->text_size] = '\0';
+    esp32_cam_ai_arena_update_peak(app, request);
+    return copy == length;
+}
+
+// Format into the text from `offset` on, cut to the room the arena has
+static void esp32_cam_ai_text_vprintf(
+    ESP32CamAI* app,
+    ESP32CamAIRequest* request,
+    size_t offset,
+    const char* format,
+    va_list args) {
+    size_t room = request->arena_top - offset;
+    int length = vsnprintf(request->text + offset, room, format, args);
+    if(length < 0) length = 0;
+    
+    request->text_size = offset + MIN((size_t)length, room - 1);
+    if((size_t)length >= room) esp32_cam_ai_text_trim_utf8(request, offset);
+    esp32_cam_ai_arena_update_peak(app, request);
+}
+
+static void esp32_cam_ai_text_printf(ESP32CamAI* app, ESP32CamAIRequest* request, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    esp32_cam_ai_text_vprintf(app, request, request->text_size, format, args);
+    va_end(args);
+}
+
+// Replace the text of the current request. Appending to it keeps the
+// generation so the response view only wraps the new tail.
+void esp32_cam_ai_response_set(ESP32CamAI* app, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    esp32_cam_ai_text_vprintf(app, app->request, 0, format, args);
+    va_end(args);
+    app->request->generation = ++app->response_generation;
+}
+
+// Copy the focused request into the back snapshot and hand it to the GUI. Only
+// the single producer may call this: the worker, or the GUI while no worker runs.
+void esp32_cam_ai_response_publish(ESP32CamAI* app) {
+    const ESP32CamAIRequest* request = &app->requests[app->request_focus];
+    ESP32CamAIResponseSnapshot* snapshot = &app->response_snapshots[app->response_buffer.back];
+    
+    // The cache thread is writing that text; the lookup coming back refreshes it
+    if(__atomic_load_n(&request->cache_loan, __ATOMIC_ACQUIRE) == ESP32CamAICacheLoanLookup) return;
+    furi_string_set_strn(snapshot->text, request->text, request->text_size);
+    snapshot->generation = request->generation;
+    snapshot->change_tick = app->ui_change_tick;
+    snapshot->stats_command = request->stats_command;
+    snapshot->stats_final_tick = request->stats_final_tick;
+    esp32_cam_ai_triple_publish(&app->response_buffer);
+}
+
+// Put the selected answer cap in effect as far as the arenas allow, from the
+// next fragment on; the rest waits for the arenas of the next launch. Returns
+// the cap now in effect. A lone value, so a relaxed store publishes it.
+uint32_t esp32_cam_ai_response_cap_apply(ESP32CamAI* app) {
+    uint32_t cap = MIN(app->response_cap, app->request_arena_size - REQUEST_ARENA_EXTRA);
+    __atomic_store_n(&app->response_cap_active, cap, __ATOMIC_RELAXED);
+    return cap;
+}
+
+// Swap the latest published snapshot into front. GUI side only; call with the
+// response view model locked so a draw never reads a buffer being recycled.
+const ESP32CamAIResponseSnapshot* esp32_cam_ai_response_acquire(ESP32CamAI* app) {
+    esp32_cam_ai_triple_acquire(&app->response_buffer);
+    return &app->response_snapshots[app->response_buffer.front];
+}
+
+// Claim the next event log record, overwriting the oldest. Worker thread only:
+// a single writer and no reader while it runs keep this free of locks.
+static ESP32CamAILogRecord* esp32_cam_ai_log(ESP32CamAI* app, ESP32CamAILogEvent event, uint8_t tag) {
+    ESP32CamAILogRecord* record = &app->log[app->log_head++ & (EVENT_LOG_SIZE - 1)];
+    record->tick = furi_get_tick();
+    record->event = event;
+    record->tag = tag;
+    record->length = 0;
+    return record;
+}
+
+static void esp32_cam_ai_log_text(ESP32CamAI* app, ESP32CamAILogEvent event, uint8_t tag, const char* text) {
+    ESP32CamAILogRecord* record = esp32_cam_ai_log(app, event, tag);
+    size_t length = strlen(text);
+    record->length = MIN(length, (size_t)UINT16_MAX);
+    memcpy(record->text, text, MIN(length, sizeof(record->text)));
+}
+
+static void esp32_cam_ai_log_args(
+    ESP32CamAI* app,
+    ESP32CamAILogEvent event,
+    uint8_t tag,
+    uint32_t arg0,
+    uint32_t arg1,
+    uint32_t arg2) {
+    ESP32CamAILogRecord* record = esp32_cam_ai_log(app, event, tag);
+    record->args[0] = arg0;
+    record->args[1] = arg1;
+    record->args[2] = arg2;
+}
+
+// Format what the ring still holds, oldest first. Only once the worker is gone.
+static void esp32_cam_ai_log_dump(ESP32CamAI* app) {
+    uint32_t count = MIN(app->log_head, (uint32_t)EVENT_LOG_SIZE);
+    
+    for(uint32_t i = app->log_head - count; i != app->log_head; i++) {
+        const ESP32CamAILogRecord* record = &app->log[i & (EVENT_LOG_SIZE - 1)];
+        char text[EVENT_LOG_TEXT_SIZE + 1];
+        size_t length = MIN((size_t)record->length, sizeof(record->text));
+        memcpy(text, record->text, length);
+        text[length] = '\0';
+        const char* more = record->length > length ? "..." : "";
+        
+        switch(record->event) {
+            case ESP32CamAILogRxLine:
+                FURI_LOG_I(TAG, "[%lu] RX #%u %u B: '%s%s'", record->tick, record->tag, record->length, text, more);
+                break;
+            case ESP32CamAILogTxCommand:
+                FURI_LOG_I(TAG, "[%lu] Sent command #%u: %s%s", record->tick, record->tag, text, more);
+                break;
+            case ESP32CamAILogAnswer:
+                FURI_LOG_I(
+                    TAG,
+                    "[%lu] Answer #%u: %lu B from %lu B on the wire in %lu ms",
+                    record->tick,
+                    record->tag,
+                    record->args[0],
+                    record->args[1],
+                    record->args[2]);
+                break;
+            case ESP32CamAILogUnknownFrame:
+                FURI_LOG_W(TAG, "[%lu] Unknown frame type 0x%02lX", record->tick, record->args[0]);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+const char* const esp32_cam_ai_stats_commands[ESP32CamAIStatsCount] = {
+    "VISION", "MATH", "OCR", "COUNT", "CUSTOM_VISION", "CUSTOM_CHAT"};
+
+const char* const esp32_cam_ai_stats_stages[ESP32CamAIStatsStageCount] = {
+    "queue", "wait", "transfer", "display"};
+
+const uint16_t esp32_cam_ai_stats_bounds[STATS_BOUNDS] = {
+    1, 2, 5, 10, 20, 35, 50, 75, 100, 150, 200, 350,
+    500, 750, 1000, 1500, 2000, 3500, 5000, 7500, 10000, 15000, 20000, 30000};
+
+// Statistics of the command `line` is sent for, ESP32CamAIStatsCount if none
+static ESP32CamAIStatsCommand esp32_cam_ai_stats_classify(const char* line) {
+    for(size_t i = 0; i < ESP32CamAIStatsCount; i++) {
+        size_t length = strlen(esp32_cam_ai_stats_commands[i]);
+        if(strncmp(line, esp32_cam_ai_stats_commands[i], length) == 0 &&
+           (line[length] == '\0' || line[length] == ':')) {
+            return i;
+        }
+    }
+    return ESP32CamAIStatsCount;
+}
+
+void esp32_cam_ai_stats_record(
+    ESP32CamAI* app,
+    ESP32CamAIStatsCommand command,
+    ESP32CamAIStatsStage stage,
+    uint32_t ticks) {
+    if(command >= ESP32CamAIStatsCount) return;
+    
+    ESP32CamAIHistogram* histogram = &app->stats[command][stage];
+    uint32_t ms = ticks * 1000 / furi_kernel_get_tick_frequency();
+    size_t bucket = 0;
+    while(bucket < COUNT_OF(esp32_cam_ai_stats_bounds) && ms >= esp32_cam_ai_stats_bounds[bucket]) {
+        bucket++;
+    }
+    furi_mutex_acquire(app->stats_mutex, FuriWaitForever);
+    histogram->buckets[bucket]++;
+    histogram->min_ms = histogram->count ? MIN(histogram->min_ms, ms) : ms;
+    histogram->max_ms = MAX(histogram->max_ms, ms);
+    histogram->count++;
+    furi_mutex_release(app->stats_mutex);
+}
+
+// Upper bound of the bucket holding the `percent` percentile, kept within
+// the samples seen. Only as fine as the buckets.
+uint32_t esp32_cam_ai_stats_percentile(const ESP32CamAIHistogram* histogram, uint32_t percent) {
+    if(!histogram->count) return 0;
+    
+    uint32_t rank = (histogram->count * percent + 99) / 100;
+    uint32_t seen = 0;
+    for(size_t i = 0; i < COUNT_OF(esp32_cam_ai_stats_bounds); i++) {
+        seen += histogram->buckets[i];
+        if(seen >= rank) {
+            uint32_t bound = esp32_cam_ai_stats_bounds[i];
+            return MAX(MIN(bound, histogram->max_ms), histogram->min_ms);
+        }
+    }
+    return histogram->max_ms;
+}
+
+// Write every histogram of `stats` to STATS_PATH, one row per command and stage
+bool esp32_cam_ai_stats_export(
+    const ESP32CamAIHistogram stats[ESP32CamAIStatsCount][ESP32CamAIStatsStageCount]) {
+    FuriString* row = furi_string_alloc();
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    File* file = storage_file_alloc(storage);
+    
+    bool written = storage_file_open(file, STATS_PATH, FSAM_WRITE, FSOM_CREATE_ALWAYS);
+    if(written) {
+        furi_string_set(row, "command,stage,count,min_ms,p50_ms,p95_ms,max_ms");
+        for(size_t i = 0; i < COUNT_OF(esp32_cam_ai_stats_bounds); i++) {
+            furi_string_cat_printf(row, ",lt_%u", esp32_cam_ai_stats_bounds[i]);
+        }
+        furi_string_cat_str(row, ",over\n");
+        written = storage_file_write(file, furi_string_get_cstr(row), furi_string_size(row)) ==
+                  furi_string_size(row);
+    }
+    for(size_t command = 0; written && command < ESP32CamAIStatsCount; command++) {
+        for(size_t stage = 0; written && stage < ESP32CamAIStatsStageCount; stage++) {
+            const ESP32CamAIHistogram* histogram = &stats[command][stage];
+            furi_string_printf(
+                row,
+                "%s,%s,%lu,%lu,%lu,%lu,%lu",
+                esp32_cam_ai_stats_commands[command],
+                esp32_cam_ai_stats_stages[stage],
+                histogram->count,
+                histogram->min_ms,
+                esp32_cam_ai_stats_percentile(histogram, 50),
+                esp32_cam_ai_stats_percentile(histogram, 95),
+                histogram->max_ms);
+            for(size_t i = 0; i < STATS_BUCKETS; i++) {
+                furi_string_cat_printf(row, ",%lu", histogram->buckets[i]);
+            }
+            furi_string_push_back(row, '\n');
+            written = storage_file_write(file, furi_string_get_cstr(row), furi_string_size(row)) ==
+                      furi_string_size(row);
+        }
+    }
+    
+    storage_file_close(file);
+    storage_file_free(file);
+    furi_record_close(RECORD_STORAGE);
+    furi_string_free(row);
+    return written;
+}
+
+// UART Functions
+static void esp32_cam_ai_uart_queue_command(ESP32CamAI* app, const ESP32CamAICommand* command) {
+    if(furi_message_queue_put(app->tx_queue, command, 0) == FuriStatusOk) {
+        furi_thread_flags_set(furi_thread_get_id(app->worker_thread), ESP32CamAIWorkerEventTx);
+    } else {
+        FURI_LOG_W(TAG, "TX queue full, dropped: %s", command->line);
+    }
+}
+
+// Answer cache. Lookups and stores run on the cache thread so SD card access
+// never delays the worker's RX path.
+
+static void esp32_cam_ai_cache_path(char* path, size_t size, uint32_t hash) {
+    snprintf(path, size, CACHE_PATH "/%08lX.txt", hash);
+}
+
+// Drop an entry and its file
+static void esp32_cam_ai_cache_remove(ESP32CamAI* app, Storage* storage, size_t slot) {
+    char path[64];
+    esp32_cam_ai_cache_path(path, sizeof(path), app->cache_index.entries[slot].hash);
+    storage_simply_remove(storage, path);
+    esp32_cam_ai_cache_index_remove(&app->cache_index, slot);
+    app->cache_index_dirty = true;
+}
+
+static void esp32_cam_ai_cache_evict_lru(ESP32CamAI* app, Storage* storage) {
+    size_t oldest = esp32_cam_ai_cache_index_oldest(&app->cache_index);
+    if(oldest != CACHE_SLOTS) esp32_cam_ai_cache_remove(app, storage, oldest);
+}
+
+void esp32_cam_ai_cache_clear(ESP32CamAI* app, Storage* storage) {
+    storage_simply_remove_recursive(storage, CACHE_PATH);
+    memset(&app->cache_index, 0, sizeof(app->cache_index));
+    app->cache_index_dirty = false;
+    FURI_LOG_I(TAG, "Answer cache cleared");
+}
+
+// Read the answer for `key` into the text of `request`, which is on loan.
+// The file goes into the arena in one read, below the command line at its
+// top. It starts with the key, so a hash collision reads as a miss and leaves
+// the other prompt's answer be. Only an entry whose file is gone is dropped.
+static bool esp32_cam_ai_cache_lookup(
+    ESP32CamAI* app,
+    Storage* storage,
+    const char* key,
+    size_t key_size,
+    ESP32CamAIRequest* request) {
+    ESP32CamAICacheIndex* index = &app->cache_index;
+    size_t slot = esp32_cam_ai_cache_slot(index, esp32_cam_ai_cache_hash(key, key_size));
+    if(!index->entries[slot].hash) return false;
+    
+    char path[64];
+    esp32_cam_ai_cache_path(path, sizeof(path), index->entries[slot].hash);
+    
+    size_t size = index->entries[slot].size;
+    bool found = false;
+    File* file = storage_file_alloc(storage);
+    bool exists = storage_file_open(file, path, FSAM_READ, FSOM_OPEN_EXISTING);
+    if(exists && storage_file_size(file) == size && size > key_size && size < request->arena_top &&
+       storage_file_read(file, request->text, size) == size) {
+        found = memcmp(request->text, key, key_size) == 0 &&
+                request->text[key_size] == '\n';
+    }
+    storage_file_close(file);
+    storage_file_free(file);
+    
+    request->text_size = found ? size - key_size - 1 : 0;
+    memmove(request->text, request->text + key_size + 1, request->text_size);
+    request->text[request->text_size] = '\0';
+    esp32_cam_ai_arena_update_peak(app, request);
+    
+    if(found) {
+        index->entries[slot].last_used = ++index->clock;
+        app->cache_index_dirty = true;
+    } else if(!exists) {
+        esp32_cam_ai_cache_remove(app, storage, slot);
+    }
+    return found;
+}
+
+static void esp32_cam_ai_cache_store(
+    ESP32CamAI* app,
+    Storage* storage,
+    const char* key,
+    size_t key_size,
+    const char* answer,
+    size_t answer_size) {
+    ESP32CamAICacheIndex* index = &app->cache_index;
+    uint32_t hash = esp32_cam_ai_cache_hash(key, key_size);
+    uint32_t size = key_size + 1 + answer_size;
+    if(size > CACHE_SIZE_MAX) return;
+    
+    size_t slot = esp32_cam_ai_cache_slot(index, hash);
+    if(index->entries[slot].hash) esp32_cam_ai_cache_remove(app, storage, slot);
+    while(index->count > 0 &&
+          (index->count >= CACHE_ENTRIES_MAX || index->total_size + size > CACHE_SIZE_MAX)) {
+        esp32_cam_ai_cache_evict_lru(app, storage);
+    }
+    
+    char path[64];
+    esp32_cam_ai_cache_path(path, sizeof(path), hash);
+    storage_simply_mkdir(storage, CACHE_PATH);
+    
+    File* file = storage_file_alloc(storage);
+    bool written = storage_file_open(file, path, FSAM_WRITE, FSOM_CREATE_ALWAYS) &&
+                   storage_file_write(file, key, key_size) == key_size &&
+                   storage_file_write(file, "\n", 1) == 1 &&
+                   storage_file_write(file, answer, answer_size) == answer_size;
+    storage_file_close(file);
+    storage_file_free(file);
+    
+    if(!written) {
+        storage_simply_remove(storage, path);
+        return;
+    }
+    
+    // Removals may have shifted the probe sequence
+    slot = esp32_cam_ai_cache_slot(index, hash);
+    index->entries[slot].hash = hash;
+    index->entries[slot].size = size;
+    index->entries[slot].last_used = ++index->clock;
+    index->count++;
+    index->total_size += size;
+    app->cache_index_dirty = true;
+}
+
+// Give a slot back to the worker
+static void esp32_cam_ai_cache_return(ESP32CamAI* app, ESP32CamAIRequest* request, uint32_t loan) {
+    __atomic_store_n(&request->cache_loan, loan, __ATOMIC_RELEASE);
+    furi_thread_flags_set(furi_thread_get_id(app->worker_thread), ESP32CamAIWorkerEventCache);
+}
+
+static int32_t esp32_cam_ai_cache_worker(void* context) {
+    ESP32CamAI* app = (ESP32CamAI*)context;
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    char key[TX_COMMAND_SIZE];          // Never longer than the command it is made of
+    size_t key_size;
+    
+    // Without a valid index the answer files are orphans
+    if(!saved_struct_load(
+           CACHE_INDEX_PATH,
+           &app->cache_index,
+           sizeof(app->cache_index),
+           CACHE_INDEX_MAGIC,
+           CACHE_INDEX_VERSION) ||
+       app->cache_index.count > CACHE_ENTRIES_MAX) {
+        esp32_cam_ai_cache_clear(app, storage);
+    }
+    app->cache_index_dirty = false;
+    
+    ESP32CamAICacheMessage* message = &app->cache_message;
+    while(furi_message_queue_get(app->cache_queue, message, FuriWaitForever) == FuriStatusOk &&
+          message->op != ESP32CamAICacheOpStop) {
+        switch(message->op) {
+            case ESP32CamAICacheOpLookup: {
+                key_size = esp32_cam_ai_cache_key(key, sizeof(key), message->line);
+                bool hit = esp32_cam_ai_cache_lookup(app, storage, key, key_size, message->request);
+                if(hit) {
+                    app->cache_hits++;
+                } else {
+                    app->cache_misses++;
+                }
+                esp32_cam_ai_cache_return(
+                    app, message->request, hit ? ESP32CamAICacheLoanHit : ESP32CamAICacheLoanMiss);
+                break;
+            }
+            case ESP32CamAICacheOpStore:
+                key_size = esp32_cam_ai_cache_key(key, sizeof(key), message->line);
+                esp32_cam_ai_cache_store(
+                    app, storage, key, key_size, message->request->text, message->answer_size);
+                esp32_cam_ai_cache_return(app, message->request, ESP32CamAICacheLoanNone);
+                break;
+            case ESP32CamAICacheOpClear:
+                esp32_cam_ai_cache_clear(app, storage);
+                break;
+            default:
+                break;
+        }
+        
+        // Hits only move entries in the LRU order; losing that on a crash is harmless
+        if(app->cache_index_dirty && message->op != ESP32CamAICacheOpLookup) {
+            saved_struct_save(
+                CACHE_INDEX_PATH,
+                &app->cache_index,
+                sizeof(app->cache_index),
+                CACHE_INDEX_MAGIC,
+                CACHE_INDEX_VERSION);
+            app->cache_index_dirty = false;
+        }
+    }
+    
+    if(app->cache_index_dirty) {
+        saved_struct_save(
+            CACHE_INDEX_PATH,
+            &app->cache_index,
+            sizeof(app->cache_index),
+            CACHE_INDEX_MAGIC,
+            CACHE_INDEX_VERSION);
+    }
+    furi_record_close(RECORD_STORAGE);
+    return 0;
+}
+
+// Whether the slot is with the cache thread or back from it uncollected
+static bool esp32_cam_ai_cache_on_loan(const ESP32CamAIRequest* request) {
+    return __atomic_load_n(&request->cache_loan, __ATOMIC_ACQUIRE) != ESP32CamAICacheLoanNone;
+}
+
+// Lend `request` to the cache thread, false if its queue is full. Worker
+// thread only.
+static bool esp32_cam_ai_cache_lend(
+    ESP32CamAI* app,
+    ESP32CamAIRequest* request,
+    ESP32CamAICacheOp op,
+    uint32_t loan) {
+    ESP32CamAICacheMessage message = {
+        .op = op,
+        .request = request,
+        .line = request->cache_line,
+        .answer_size = request->text_size,
+    };
+    __atomic_store_n(&request->cache_loan, loan, __ATOMIC_RELEASE);
+    if(furi_message_queue_put(app->cache_queue, &message, 0) == FuriStatusOk) return true;
+    
+    __atomic_store_n(&request->cache_loan, ESP32CamAICacheLoanNone, __ATOMIC_RELEASE);
+    return false;
+}
+
+// Hand a finished answer to the cache thread. The slot stays on loan until
+// the answer is on the card. Worker thread only.
+static void esp32_cam_ai_cache_put(ESP32CamAI* app, ESP32CamAIRequest* request) {
+    if(!request->cache_line) return;
+    
+    esp32_cam_ai_cache_lend(app, request, ESP32CamAICacheOpStore, ESP32CamAICacheLoanStore);
+    request->cache_line = NULL;
+}
+
+// Capture archive. Image frames go from the RX line buffer into
+// archive_stream and from there straight into the archive thread's write
+// block, so a capture is never held in one piece anywhere.
+
+// Read exactly `size` bytes of a record. Archive thread only.
+static void esp32_cam_ai_archive_read(ESP32CamAI* app, void* data, size_t size) {
+    uint8_t* bytes = data;
+    while(size > 0) {
+        size_t received = furi_stream_buffer_receive(app->archive_stream, bytes, size, FuriWaitForever);
+        bytes += received;
+        size -= received;
+    }
+}
+
+static void esp32_cam_ai_archive_flush(ESP32CamAIArchiveWriter* writer) {
+    if(writer->fill == 0) return;
+    
+    if(writer->ok) {
+        uint32_t start = furi_get_tick();
+        writer->ok = storage_file_write(writer->file, writer->block, writer->fill) == writer->fill;
+        writer->write_ticks += furi_get_tick() - start;
+        writer->size += writer->fill;
+    }
+    writer->fill = 0;
+}
+
+// Copy `length` record bytes into the writer's block, writing out full blocks
+static void esp32_cam_ai_archive_fill(ESP32CamAI* app, ESP32CamAIArchiveWriter* writer, size_t length) {
+    while(length > 0) {
+        size_t part = MIN(length, ARCHIVE_BLOCK_SIZE - writer->fill);
+        esp32_cam_ai_archive_read(app, writer->block + writer->fill, part);
+        writer->fill += part;
+        length -= part;
+        if(writer->fill == ARCHIVE_BLOCK_SIZE) esp32_cam_ai_archive_flush(writer);
+    }
+}
+
+// Finish the trace, whatever made it into it is kept
+static void esp32_cam_ai_archive_trace_close(ESP32CamAIArchiveWriter* trace) {
+    esp32_cam_ai_archive_flush(trace);
+    storage_file_close(trace->file);
+    storage_file_free(trace->file);
+    free(trace->block);
+    FURI_LOG_I(TAG, "Trace saved: %lu B%s", trace->size, trace->ok ? "" : ", write failed");
+    trace->file = NULL;
+}
+
+static void esp32_cam_ai_archive_close(
+    ESP32CamAI* app,
+    Storage* storage,
+    ESP32CamAIArchiveWriter* writer,
+    const char* path,
+    bool keep) {
+    esp32_cam_ai_archive_flush(writer);
+    storage_file_close(writer->file);
+    
+    if(!keep || !writer->ok) {
+        storage_simply_remove(storage, path);
+        if(keep) app->archive_dropped++;
+        return;
+    }
+    
+    app->archive_saved++;
+    if(writer->write_ticks > 0) {
+        app->archive_rate =
+            (uint64_t)writer->size * furi_kernel_get_tick_frequency() / writer->write_ticks;
+    }
+    FURI_LOG_I(TAG, "Archived %s: %lu B at %lu B/s", path, writer->size, app->archive_rate);
+}
+
+static int32_t esp32_cam_ai_archive_worker(void* context) {
+    ESP32CamAI* app = (ESP32CamAI*)context;
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    storage_simply_mkdir(storage, ARCHIVE_PATH);
+    
+    ESP32CamAIArchiveWriter writer = {
+        .file = storage_file_alloc(storage),
+        .block = malloc(ARCHIVE_BLOCK_SIZE),
+    };
+    ESP32CamAIArchiveWriter trace = {0};   // Block allocated while a trace is open
+    bool open = false;
+    char path[64];
+    
+    while(1) {
+        uint8_t header[ARCHIVE_RECORD_HEADER_SIZE];
+        esp32_cam_ai_archive_read(app, header, sizeof(header));
+        size_t length = header[1] | (header[2] << 8);
+        if(header[0] == ESP32CamAIArchiveStop) break;
+        
+        switch(header[0]) {
+            case ESP32CamAIArchiveOpen: {
+                char name[ARCHIVE_NAME_SIZE + 8];
+                furi_check(length < sizeof(name));
+                esp32_cam_ai_archive_read(app, name, length);
+                name[length] = '\0';
+                snprintf(path, sizeof(path), "%s/%s", ARCHIVE_PATH, name);
+                
+                writer.ok = storage_file_open(writer.file, path, FSAM_WRITE, FSOM_CREATE_ALWAYS);
+                writer.fill = 0;
+                writer.size = 0;
+                writer.write_ticks = 0;
+                open = true;
+                break;
+            }
+            case ESP32CamAIArchiveData:
+                // Fill the block in place and write it out whenever it is full
+                esp32_cam_ai_archive_fill(app, &writer, length);
+                break;
+            case ESP32CamAIArchiveClose: {
+                uint8_t keep = 0;
+                esp32_cam_ai_archive_read(app, &keep, 1);
+                if(open) esp32_cam_ai_archive_close(app, storage, &writer, path, keep);
+                open = false;
+                break;
+            }
+            case ESP32CamAIArchiveTraceOpen:
+                if(trace.file) esp32_cam_ai_archive_trace_close(&trace);
+                trace.file = storage_file_alloc(storage);
+                trace.block = malloc(ARCHIVE_BLOCK_SIZE);
+                trace.ok = storage_file_open(trace.file, TRACE_PATH, FSAM_WRITE, FSOM_CREATE_ALWAYS);
+                trace.fill = 0;
+                trace.size = 0;
+                break;
+            case ESP32CamAIArchiveTrace:
+                if(trace.file) {
+                    esp32_cam_ai_archive_fill(app, &trace, length);
+                } else {
+                    uint8_t skip[16];
+                    for(size_t part; length > 0; length -= part) {
+                        part = MIN(length, sizeof(skip));
+                        esp32_cam_ai_archive_read(app, skip, part);
+                    }
+                }
+                break;
+            case ESP32CamAIArchiveTraceClose:
+                if(trace.file) esp32_cam_ai_archive_trace_close(&trace);
+                break;
+            default:
+                break;
+        }
+    }
+    
+    // The worker stopped in the middle of a file
+    if(open) esp32_cam_ai_archive_close(app, storage, &writer, path, false);
+    if(trace.file) esp32_cam_ai_archive_trace_close(&trace);
+    free(writer.block);
+    storage_file_free(writer.file);
+    furi_record_close(RECORD_STORAGE);
+    return 0;
+}
+
+// Bring up the archive thread and its stream once the peer agreed to send
+// captures or a trace is captured, so a session without either never pays
+// for them. They stay until the UART is released. Worker thread only.
+static void esp32_cam_ai_archive_start(ESP32CamAI* app) {
+    if(app->archive_thread) return;
+    
+    app->archive_stream = furi_stream_buffer_alloc(ARCHIVE_STREAM_SIZE, 1);
+    app->archive_thread =
+        furi_thread_alloc_ex("ESP32CamArchive", 2048, esp32_cam_ai_archive_worker, app);
+    furi_thread_start(app->archive_thread);
+}
+
+// Queue one record without waiting. Everything but the closing records leaves
+// room for a Close and a TraceClose behind it, so open files can always be
+// finished. Worker thread only.
+static bool esp32_cam_ai_archive_put(
+    ESP32CamAI* app,
+    ESP32CamAIArchiveRecord type,
+    const void* data,
+    size_t size) {
+    if(!app->archive_stream) return false;
+    
+    bool closing = type == ESP32CamAIArchiveClose || type == ESP32CamAIArchiveTraceClose;
+    size_t reserve = (closing ? 1 : 2) * (ARCHIVE_RECORD_HEADER_SIZE + 1);
+    if(furi_stream_buffer_spaces_available(app->archive_stream) <
+       ARCHIVE_RECORD_HEADER_SIZE + size + reserve) {
+        return false;
+    }
+    
+    uint8_t header[ARCHIVE_RECORD_HEADER_SIZE] = {type, size & 0xFF, size >> 8};
+    furi_stream_buffer_send(app->archive_stream, header, sizeof(header), 0);
+    if(size) furi_stream_buffer_send(app->archive_stream, data, size, 0);
+    return true;
+}
+
+static void esp32_cam_ai_archive_finish(ESP32CamAI* app, bool keep) {
+    uint8_t flag = keep;
+    esp32_cam_ai_archive_put(app, ESP32CamAIArchiveClose, &flag, 1);
+    if(!keep) {
+        FURI_LOG_W(TAG, "Archive file dropped");
+        app->archive_dropped++;
+    }
+}
+
+// Commands that take a picture the peer can send along
+static bool esp32_cam_ai_archive_captures(const char* line) {
+    static const char* const commands[] = {"VISION", "MATH", "OCR", "COUNT", "CUSTOM_VISION:"};
+    for(size_t i = 0; i < COUNT_OF(commands); i++) {
+        if(strncmp(line, commands[i], strlen(commands[i])) == 0) return true;
+    }
+    return false;
+}
+
+// Name the files of a request's capture and answer after the time it was sent
+static void esp32_cam_ai_archive_name(ESP32CamAI* app, ESP32CamAIRequest* request) {
+    DateTime now;
+    furi_hal_rtc_get_datetime(&now);
+    snprintf(
+        request->archive_name,
+        sizeof(request->archive_name),
+        "%04u%02u%02u-%02u%02u%02u-%02lu",
+        now.year,
+        now.month,
+        now.day,
+        now.hour,
+        now.minute,
+        now.second,
+        app->archive_next++ % 100);
+}
+
+static void esp32_cam_ai_archive_jpeg_done(ESP32CamAI* app, bool complete) {
+    app->archive_jpeg_active = false;
+    esp32_cam_ai_archive_finish(app, complete);
+}
+
+// Pass one image frame on as it arrives. A lost frame or a full stream ends
+// the capture, which the archive thread then removes.
+static void esp32_cam_ai_archive_jpeg_data(ESP32CamAI* app, const uint8_t* data, size_t size) {
+    if(!app->archive_jpeg_active || size < 4) return;
+    
+    uint32_t offset = data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+    data += 4;
+    size -= 4;
+    if(offset != app->archive_jpeg_received || size > app->archive_jpeg_size - offset ||
+       !esp32_cam_ai_archive_put(app, ESP32CamAIArchiveData, data, size)) {
+        esp32_cam_ai_archive_jpeg_done(app, false);
+        return;
+    }
+    
+    app->archive_jpeg_received += size;
+    if(app->archive_jpeg_received == app->archive_jpeg_size) {
+        esp32_cam_ai_archive_jpeg_done(app, true);
+    }
+}
+
+// The session replays a trace instead of talking to the ESP32-CAM. Nothing is
+// ever sent to the real peer then, not even after the trace is through.
+static bool esp32_cam_ai_trace_is_replay(ESP32CamAI* app) {
+    return app->trace_session == ESP32CamAITraceReplay ||
+           app->trace_session == ESP32CamAITraceReplayFast;
+}
+
+// UART trace capture. Records go to the archive thread like captures do; a
+// record that does not fit ends the trace, since replaying across a gap
+// would diverge from what happened. Worker thread only.
+static void esp32_cam_ai_trace_put(
+    ESP32CamAI* app,
+    ESP32CamAITraceKind kind,
+    const void* data,
+    size_t size) {
+    if(!app->trace_capturing) return;
+    
+    size_t length = TRACE_RECORD_HEADER_SIZE + size;
+    uint32_t tick = furi_get_tick() - app->trace_start_tick;
+    uint8_t header[ARCHIVE_RECORD_HEADER_SIZE + TRACE_RECORD_HEADER_SIZE] = {
+        ESP32CamAIArchiveTrace, length & 0xFF, length >> 8,
+        kind, tick & 0xFF, (tick >> 8) & 0xFF, (tick >> 16) & 0xFF, tick >> 24,
+        size & 0xFF, size >> 8};
+    if(furi_stream_buffer_spaces_available(app->archive_stream) <
+       sizeof(header) + size + 2 * (ARCHIVE_RECORD_HEADER_SIZE + 1)) {
+        FURI_LOG_W(TAG, "Trace cut short after %lu B", app->trace_bytes);
+        app->trace_capturing = false;
+        app->trace_cut = true;
+        esp32_cam_ai_archive_put(app, ESP32CamAIArchiveTraceClose, NULL, 0);
+        return;
+    }
+    
+    furi_stream_buffer_send(app->archive_stream, header, sizeof(header), 0);
+    if(size) furi_stream_buffer_send(app->archive_stream, data, size, 0);
+    app->trace_bytes += length;
+}
+
+static void esp32_cam_ai_trace_begin(ESP32CamAI* app) {
+    app->trace_capturing = esp32_cam_ai_archive_put(app, ESP32CamAIArchiveTraceOpen, NULL, 0) &&
+                           esp32_cam_ai_archive_put(
+                               app, ESP32CamAIArchiveTrace, TRACE_MAGIC, TRACE_MAGIC_SIZE);
+    app->trace_start_tick = furi_get_tick();
+}
+
+static void esp32_cam_ai_trace_end(ESP32CamAI* app) {
+    if(!app->trace_capturing) return;
+    app->trace_capturing = false;
+    esp32_cam_ai_archive_put(app, ESP32CamAIArchiveTraceClose, NULL, 0);
+}
+
+// Record a finished answer, or check it against the trace while replaying
+static void esp32_cam_ai_trace_answer(ESP32CamAI* app, ESP32CamAIRequest* request) {
+    uint32_t hash = esp32_cam_ai_fnv1a(request->text, request->text_size);
+    
+    if(app->trace_replaying) {
+        if(app->trace_answer_count < TRACE_ANSWERS_MAX) {
+            app->trace_answers[app->trace_answer_count++] = hash;
+        }
+        return;
+    }
+    uint8_t record[5] = {
+        request->id, hash & 0xFF, (hash >> 8) & 0xFF, (hash >> 16) & 0xFF, hash >> 24};
+    esp32_cam_ai_trace_put(app, ESP32CamAITraceAnswer, record, sizeof(record));
+}
+
+// Save a finished answer next to its capture. The peer sends the capture
+// before the final reply; one still streaming then is cut short.
+static void esp32_cam_ai_archive_answer(ESP32CamAI* app, ESP32CamAIRequest* request) {
+    if(request->archive_name[0] == '\0') return;
+    if(app->archive_jpeg_active) esp32_cam_ai_archive_jpeg_done(app, false);
+    
+    char name[ARCHIVE_NAME_SIZE + 4];
+    snprintf(name, sizeof(name), "%s.txt", request->archive_name);
+    request->archive_name[0] = '\0';
+    if(!esp32_cam_ai_archive_put(app, ESP32CamAIArchiveOpen, name, strlen(name))) {
+        app->archive_dropped++;
+        return;
+    }
+    
+    const char* text = request->text;
+    size_t left = request->text_size;
+    bool complete = true;
+    while(complete && left > 0) {
+        size_t part = MIN(left, (size_t)ARCHIVE_CHUNK_SIZE);
+        complete = esp32_cam_ai_archive_put(app, ESP32CamAIArchiveData, text, part);
+        text += part;
+        left -= part;
+    }
+    esp32_cam_ai_archive_finish(app, complete);
+}
+
+void esp32_cam_ai_uart_send_command(ESP32CamAI* app, const char* command) {
+    if(app->main_link.serial_handle) {
+        ESP32CamAICommand tx;
+        snprintf(tx.line, sizeof(tx.line), "%s", command);
+        tx.question_offset = 0;
+        tx.cacheable = false;
+        tx.cached = false;
+        tx.queued_tick = furi_get_tick();
+        esp32_cam_ai_uart_queue_command(app, &tx);
+    }
+}
+
+// NUOVO: Invio comando custom con domanda
+void esp32_cam_ai_uart_send_custom_command(ESP32CamAI* app, const char* prefix, const char* question) {
+    if(app->main_link.serial_handle) {
+        // Costruisci comando: "CUSTOM_VISION:domanda" o "CUSTOM_CHAT:domanda"
+        ESP32CamAICommand tx;
+        snprintf(tx.line, sizeof(tx.line), "%s%s", prefix, question);
+        tx.question_offset = strlen(prefix);
+        tx.cached = false;
+        tx.queued_tick = furi_get_tick();
+        
+        // Vision answers depend on the current frame, only chat answers repeat
+        tx.cacheable = strcmp(prefix, "CUSTOM_CHAT:") == 0;
+        esp32_cam_ai_uart_queue_command(app, &tx);
+    }
+}
+
+// Post a pending response refresh unless one went out less than
+// UI_REFRESH_INTERVAL_MS ago. Worker thread only.
+static void esp32_cam_ai_response_flush(ESP32CamAI* app) {
+    if(!app->ui_pending) return;
+    
+    uint32_t now = furi_get_tick();
+    if(now - app->ui_last_post_tick < furi_ms_to_ticks(UI_REFRESH_INTERVAL_MS)) return;
+    
+    app->ui_pending = false;
+    app->ui_last_post_tick = now;
+    esp32_cam_ai_response_publish(app);
+    view_dispatcher_send_custom_event(app->view_dispatcher, ESP32CamAIEventUpdateResponse);
+}
+
+// Ticks until a deferred refresh is due, or `timeout` if nothing is pending
+static uint32_t esp32_cam_ai_response_flush_timeout(ESP32CamAI* app, uint32_t timeout) {
+    if(!app->ui_pending) return timeout;
+    
+    uint32_t elapsed = furi_get_tick() - app->ui_last_post_tick;
+    uint32_t interval = furi_ms_to_ticks(UI_REFRESH_INTERVAL_MS);
+    return elapsed < interval ? MIN(interval - elapsed, timeout) : 0;
+}
+
+// Mark the current request as changed. Focus moves to it unless the focused
+// request is still waiting for its answer. Worker thread only.
+static void esp32_cam_ai_response_changed(ESP32CamAI* app) {
+    size_t slot = app->request - app->requests;
+    if(slot != app->request_focus) {
+        if(app->requests[app->request_focus].pending) return;
+        app->request_focus = slot;
+    }
+    
+    if(!app->ui_pending) {
+        app->ui_pending = true;
+        app->ui_change_tick = furi_get_tick();
+    }
+    esp32_cam_ai_response_flush(app);
+}
+
+// DMA RX callback: fires on half/full transfer and on idle line, so a whole
+// burst is drained with one stream buffer operation per staging chunk
+static void esp32_cam_ai_uart_rx_callback(
+    FuriHalSerialHandle* handle,
+    FuriHalSerialRxEvent event,
+    size_t data_len,
+    void* context) {
+    ESP32CamAILink* link = context;
+    
+    if(event & FuriHalSerialRxEventOverrunError) {
+        link->rx_overruns++;
+    }
+    
+    if(event & (FuriHalSerialRxEventData | FuriHalSerialRxEventIdle)) {
+        while(data_len > 0) {
+            size_t len = furi_hal_serial_dma_rx(
+                handle, link->rx_staging, MIN(data_len, sizeof(link->rx_staging)));
+            if(len == 0) break;
+            
+            size_t sent = furi_stream_buffer_send(link->rx_stream, link->rx_staging, len, 0);
+            link->rx_bytes += len;
+            link->rx_dropped += len - sent;
+            data_len -= len;
+        }
+        furi_thread_flags_set(furi_thread_get_id(link->app->worker_thread), ESP32CamAIWorkerEventRx);
+    }
+}
+
+// Send one protocol line in the current link mode. Worker thread only.
+static void esp32_cam_ai_worker_send_line(ESP32CamAI* app, const char* line) {
+    size_t length = strlen(line);
+    
+    if(esp32_cam_ai_trace_is_replay(app)) return;
+    
+    if(app->link_framed) {
+        size_t size = esp32_cam_ai_frame_encode(
+            ESP32CamAIFrameText, (const uint8_t*)line, length, app->tx_frame_raw, app->tx_frame);
+        furi_check(size > 0);
+        furi_hal_serial_tx(app->main_link.serial_handle, app->tx_frame, size);
+        esp32_cam_ai_trace_put(app, ESP32CamAITraceTx, app->tx_frame, size);
+    } else {
+        furi_hal_serial_tx(app->main_link.serial_handle, (const uint8_t*)line, length);
+        furi_hal_serial_tx(app->main_link.serial_handle, (const uint8_t*)"\n", 1);
+        esp32_cam_ai_trace_put(app, ESP32CamAITraceTx, line, length);
+    }
+}
+
+// Make a capability offer and wait for its answer
+static void esp32_cam_ai_link_step_send(ESP32CamAI* app, ESP32CamAILinkStep step, const char* line) {
+    esp32_cam_ai_worker_send_line(app, line);
+    app->link_step = step;
+    app->link_step_deadline = furi_get_tick() + furi_ms_to_ticks(LINK_STEP_TIMEOUT_MS);
+}
+
+// The link is up and nothing is being negotiated on it, so commands may go
+// out without landing in the middle of a mode or rate change
+static bool esp32_cam_ai_link_idle(ESP32CamAI* app) {
+    return app->handshake != ESP32CamAIHandshakeWaiting &&
+           app->link_step == ESP32CamAILinkStepNone && app->baud_state == ESP32CamAIBaudIdle;
+}
+
+// No untagged reply is outstanding, so the next untagged OK or ERROR can only
+// answer an offer made now. Slot 0 is pending while an untagged command waits.
+static bool esp32_cam_ai_link_quiet(ESP32CamAI* app) {
+    return !app->requests[0].pending && !esp32_cam_ai_cache_on_loan(&app->requests[0]) &&
+           !app->viewfinder_waiting;
+}
+
+// Propose baudrate_target to the peer if the link is not running at it yet
+static void esp32_cam_ai_link_negotiate_baud(ESP32CamAI* app) {
+    if(app->link_step != ESP32CamAILinkStepNone || app->baud_state != ESP32CamAIBaudIdle) return;
+    if(app->baudrate_target == app->baudrate || !esp32_cam_ai_link_quiet(app)) return;
+    
+    char command[24];
+    snprintf(command, sizeof(command), "BAUD:%lu", app->baudrate_target);
+    esp32_cam_ai_worker_send_line(app, command);
+    
+    app->baud_candidate = app->baudrate_target;
+    app->baud_state = ESP32CamAIBaudProposed;
+    app->baud_deadline = furi_get_tick() + furi_ms_to_ticks(BAUD_REPLY_TIMEOUT_MS);
+}
+
+// Give up on the candidate rate and return to the last working one. The
+// peer reverts by itself when it sees no PING within its own timeout.
+static void esp32_cam_ai_link_baud_fallback(ESP32CamAI* app) {
+    if(app->baud_state == ESP32CamAIBaudVerifying) {
+        furi_hal_serial_set_br(app->main_link.serial_handle, app->baudrate);
+    }
+    FURI_LOG_W(TAG, "Baud %lu rejected, staying at %lu", app->baud_candidate, app->baudrate);
+    
+    app->baud_state = ESP32CamAIBaudIdle;
+    app->baudrate_target = app->baudrate;
+    __atomic_store_n(&app->baudrate_verified, app->baudrate, __ATOMIC_RELAXED);
+}
+
+// Ask the peer to start or stop sending captures when that differs from the
+// setting. Returns whether it was asked. Worker thread only.
+static bool esp32_cam_ai_link_sync_archive(ESP32CamAI* app) {
+    bool enabled = app->archive_enabled;
+    if(!enabled) app->link_archive_refused = false;
+    
+    // JPEG frames need the framed link, which only exists after READY
+    if(!app->link_framed || app->link_step != ESP32CamAILinkStepNone) return false;
+    if(app->baud_state != ESP32CamAIBaudIdle || enabled == app->link_archive ||
+       app->link_archive_refused || !esp32_cam_ai_link_quiet(app)) {
+        return false;
+    }
+    
+    esp32_cam_ai_link_step_send(
+        app, ESP32CamAILinkStepArchive, app->archive_enabled ? "ARCHIVE:ON" : "ARCHIVE:OFF");
+    return true;
+}
+
+// Capability offers are through, go on with the settings that depend on them
+static void esp32_cam_ai_link_setup_done(ESP32CamAI* app) {
+    app->link_step = ESP32CamAILinkStepNone;
+    FURI_LOG_I(
+        TAG,
+        "Link: %s, %s, %s",
+        app->link_framed ? "framed" : "text",
+        app->link_tagged ? "tagged" : "untagged",
+        app->link_compressed ? "compressed" : "plain");
+    if(esp32_cam_ai_link_sync_archive(app)) return;
+    esp32_cam_ai_link_negotiate_baud(app);
+}
+
+// Record the peer's answer to the current capability offer and make the next.
+// Older firmware rejects what it does not know with ERROR.
+static void esp32_cam_ai_link_step_done(ESP32CamAI* app, bool accepted) {
+    switch(app->link_step) {
+        case ESP32CamAILinkStepFlow:
+            // Counting starts right after the FLOW:OK line, which is already counted
+            app->link_flow = accepted;
+            app->flow_consumed = 0;
+            app->flow_credited = 0;
+            esp32_cam_ai_link_step_send(app, ESP32CamAILinkStepFramed, "FRAMED");
+            break;
+        case ESP32CamAILinkStepFramed:
+            app->link_framed = accepted;
+            esp32_cam_ai_link_step_send(app, ESP32CamAILinkStepTags, "TAGS");
+            break;
+        case ESP32CamAILinkStepTags:
+            app->link_tagged = accepted;
+            if(app->link_framed) {
+                // Compressed answers are binary, only frames can carry them
+                char command[32];
+                snprintf(command, sizeof(command), "COMPRESS:LZ:%d:%d", LZ_WINDOW_BITS, LZ_LENGTH_BITS);
+                esp32_cam_ai_link_step_send(app, ESP32CamAILinkStepCompress, command);
+                break;
+            }
+            esp32_cam_ai_link_setup_done(app);
+            break;
+        case ESP32CamAILinkStepCompress:
+            app->link_compressed = accepted;
+            esp32_cam_ai_link_setup_done(app);
+            break;
+        case ESP32CamAILinkStepArchive:
+            // Firmware without archive support rejects ARCHIVE:ON
+            if(accepted) {
+                app->link_archive = !app->link_archive;
+                if(app->link_archive) esp32_cam_ai_archive_start(app);
+            } else if(!app->link_archive) {
+                app->link_archive_refused = true;
+            }
+            app->link_step = ESP32CamAILinkStepNone;
+            FURI_LOG_I(TAG, "Archive captures %s", app->link_archive ? "on" : "off");
+            esp32_cam_ai_link_negotiate_baud(app);
+            break;
+        default:
+            break;
+    }
+}
+
+// Publish the link mode for the GUI, which must not read the worker's flags.
+// Worker thread only.
+static void esp32_cam_ai_link_publish(ESP32CamAI* app) {
+    uint32_t mode = (app->link_framed ? ESP32CamAILinkModeFramed : 0) |
+                    (app->link_tagged ? ESP32CamAILinkModeTagged : 0) |
+                    (app->link_compressed ? ESP32CamAILinkModeCompressed : 0) |
+                    (app->link_flow ? ESP32CamAILinkModeFlow : 0);
+    __atomic_store_n(&app->link_mode, mode, __ATOMIC_RELEASE);
+}
+
+// Link mode last published by the worker, none while no worker runs
+uint32_t esp32_cam_ai_link_mode(ESP32CamAI* app) {
+    return app->main_link.serial_handle ? __atomic_load_n(&app->link_mode, __ATOMIC_ACQUIRE) : 0;
+}
+
+// Return the peer to how it boots, text at BAUDRATE, before the app lets go
+// of the UART, so the next launch finds it there. Firmware that does not know
+// LINK:RESET stays where it is until it is restarted. Worker thread only.
+static void esp32_cam_ai_link_reset(ESP32CamAI* app) {
+    bool negotiated = app->link_flow || app->link_framed || app->link_tagged ||
+                      app->link_compressed || app->link_archive || app->baudrate != BAUDRATE ||
+                      app->baud_state != ESP32CamAIBaudIdle;
+    if(app->handshake != ESP32CamAIHandshakeDone || !negotiated) return;
+    
+    esp32_cam_ai_worker_send_line(app, "LINK:RESET");
+    furi_hal_serial_tx_wait_complete(app->main_link.serial_handle);
+    FURI_LOG_I(TAG, "Asked the peer to reset the link");
+}
+
+static void esp32_cam_ai_link_check_timeout(ESP32CamAI* app) {
+    uint32_t now = furi_get_tick();
+    
+    // Older firmware may drop an offer it does not know instead of rejecting it
+    if(app->link_step != ESP32CamAILinkStepNone && (int32_t)(now - app->link_step_deadline) >= 0) {
+        FURI_LOG_W(TAG, "Link step %d not answered", app->link_step);
+        esp32_cam_ai_link_step_done(app, false);
+    }
+    if(app->baud_state != ESP32CamAIBaudIdle && (int32_t)(now - app->baud_deadline) >= 0) {
+        esp32_cam_ai_link_baud_fallback(app);
+    }
+}
+
+// Claim a slot for a new command: the oldest finished tagged slot, or slot 0
+// on untagged links. NULL if every tagged slot is still waiting.
+static ESP32CamAIRequest* esp32_cam_ai_request_start(ESP32CamAI* app) {
+    ESP32CamAIRequest* request = NULL;
+    
+    if(!app->link_tagged) {
+        request = &app->requests[0];
+        request->id = 0;
+    } else {
+        for(size_t i = 1; i <= REQUEST_INFLIGHT_MAX; i++) {
+            ESP32CamAIRequest* slot = &app->requests[i];
+            if(slot->pending || esp32_cam_ai_cache_on_loan(slot)) continue;
+            if(!request || (uint8_t)(slot->id - app->request_next_id) <
+                               (uint8_t)(request->id - app->request_next_id)) {
+                request = slot;
+            }
+        }
+        if(!request) return NULL;
+        
+        // Tags run 1..255, 0 marks untagged
+        request->id = app->request_next_id;
+        app->request_next_id = app->request_next_id == 255 ? 1 : app->request_next_id + 1;
+    }
+    
+    // Untagged replies can only be told apart by timing, so slot 0 is
+    // pending too and link negotiation waits for it
+    request->pending = true;
+    request->deadline = furi_get_tick() + furi_ms_to_ticks(REQUEST_TIMEOUT_MS);
+    
+    request->stream_active = false;
+    request->stream_truncated = false;
+    request->cache_line = NULL;
+    request->archive_name[0] = '\0';
+    request->stats_command = ESP32CamAIStatsCount;
+    request->stats_first_tick = 0;
+    request->stats_final_tick = 0;
+    esp32_cam_ai_arena_reset(app, request);
+    return request;
+}
+
+// Slot a reply tagged `id` belongs to. Late replies to a slot that was
+// reused since or is on loan to the cache thread fall back to slot 0.
+static ESP32CamAIRequest* esp32_cam_ai_request_find(ESP32CamAI* app, uint32_t id) {
+    for(size_t i = 1; i <= REQUEST_INFLIGHT_MAX; i++) {
+        if(id != 0 && app->requests[i].id == id && !esp32_cam_ai_cache_on_loan(&app->requests[i])) {
+            return &app->requests[i];
+        }
+    }
+    return &app->requests[0];
+}
+
+// Send a VISION or COUNT that just went to the main camera to the second one
+// too. One broadcast at a time; others only go to the main camera.
+static void esp32_cam_ai_broadcast_begin(ESP32CamAI* app, ESP32CamAIRequest* request, const char* line) {
+    ESP32CamAIRequest* second = &app->requests[REQUEST_SECOND_SLOT];
+    if(!app->second_link.receiving || app->broadcast_active) return;
+    if(request->stats_command != ESP32CamAIStatsVision &&
+       request->stats_command != ESP32CamAIStatsCounting) {
+        return;
+    }
+    
+    furi_hal_serial_tx(app->second_link.serial_handle, (const uint8_t*)line, strlen(line));
+    furi_hal_serial_tx(app->second_link.serial_handle, (const uint8_t*)"\n", 1);
+    
+    second->pending = true;
+    second->deadline = furi_get_tick() + furi_ms_to_ticks(REQUEST_TIMEOUT_MS);
+    second->stream_active = false;
+    second->stream_truncated = false;
+    second->stats_command = ESP32CamAIStatsCount;
+    esp32_cam_ai_arena_reset(app, second);
+    
+    app->broadcast_active = true;
+    app->broadcast_slot = request - app->requests;
+    app->broadcast_id = request->id;
+    app->broadcast_main_done = false;
+    app->broadcast_tick = furi_get_tick();
+}
+
+// Account a finished answer of either camera. Once both are in, the second
+// camera's answer goes below the main one, so a broadcast shows up after the
+// slower of the two rather than after both in turn. Worker thread only.
+static void esp32_cam_ai_broadcast_done(ESP32CamAI* app, ESP32CamAIRequest* request) {
+    if(!app->broadcast_active) return;
+    
+    ESP32CamAIRequest* main = &app->requests[app->broadcast_slot];
+    ESP32CamAIRequest* second = &app->requests[REQUEST_SECOND_SLOT];
+    uint32_t ms = (furi_get_tick() - app->broadcast_tick) * 1000 / furi_kernel_get_tick_frequency();
+    if(request == second) {
+        app->broadcast_second_ms = ms;
+    } else if(request == main && request->id == app->broadcast_id && !app->broadcast_main_done) {
+        app->broadcast_main_done = true;
+        app->broadcast_main_ms = ms;
+    } else {
+        return;
+    }
+    if(!app->broadcast_main_done || second->pending) return;
+    
+    app->broadcast_active = false;
+    if(esp32_cam_ai_cache_on_loan(main)) return;
+    app->request = main;
+    esp32_cam_ai_text_printf(
+        app,
+        main,
+        "\n\n📷 CAM2 (%lu ms, CAM1 %lu ms)\n",
+        app->broadcast_second_ms,
+        app->broadcast_main_ms);
+    esp32_cam_ai_text_append(app, main, second->text, second->text_size);
+    esp32_cam_ai_response_changed(app);
+}
+
+// End a pending request with an error message in its own text
+static void esp32_cam_ai_request_fail(ESP32CamAI* app, ESP32CamAIRequest* request, const char* reason) {
+    request->pending = false;
+    request->stream_active = false;
+    request->stats_command = ESP32CamAIStatsCount;
+    app->request = request;
+    esp32_cam_ai_response_set(app, "❌ %s", reason);
+    esp32_cam_ai_response_changed(app);
+    esp32_cam_ai_broadcast_done(app, request);
+}
+
+static void esp32_cam_ai_request_check_timeouts(ESP32CamAI* app) {
+    uint32_t now = furi_get_tick();
+    for(size_t i = 0; i <= REQUEST_INFLIGHT_MAX; i++) {
+        ESP32CamAIRequest* request = &app->requests[i];
+        if(request->pending && !esp32_cam_ai_cache_on_loan(request) &&
+           (int32_t)(now - request->deadline) >= 0) {
+            FURI_LOG_W(TAG, "Request #%u timed out", request->id);
+            esp32_cam_ai_request_fail(app, request, "Request timed out");
+        }
+    }
+    
+    // The second camera's answer only ever shows as part of the main one
+    ESP32CamAIRequest* second = &app->requests[REQUEST_SECOND_SLOT];
+    if(second->pending && (int32_t)(now - second->deadline) >= 0) {
+        FURI_LOG_W(TAG, "Second camera timed out");
+        second->pending = false;
+        second->stream_active = false;
+        app->request = second;
+        esp32_cam_ai_response_set(app, "❌ Request timed out");
+        esp32_cam_ai_broadcast_done(app, second);
+    }
+}
+
+// Response handlers, keyed by the token before the first ':' of a line
+typedef void (*ESP32CamAIResponseHandler)(ESP32CamAI* app, const char* arg);
+
+// Milliseconds since launch, never 0 so that 0 can mean "not yet"
+static uint32_t esp32_cam_ai_startup_ms(ESP32CamAI* app) {
+    uint32_t ms = (furi_get_tick() - app->launch_tick) * 1000 / furi_kernel_get_tick_frequency();
+    return MAX(ms, 1UL);
+}
+
+static void esp32_cam_ai_handshake_send(ESP32CamAI* app) {
+    esp32_cam_ai_worker_send_line(app, "STATUS");
+    app->handshake_attempts++;
+    app->handshake_deadline = furi_get_tick() + furi_ms_to_ticks(HANDSHAKE_TIMEOUT_MS);
+}
+
+// The peer is up. A late READY after the handshake gave up still counts.
+// Worker thread only.
+static void esp32_cam_ai_handshake_done(ESP32CamAI* app) {
+    if(app->handshake == ESP32CamAIHandshakeDone) return;
+    
+    app->handshake = ESP32CamAIHandshakeDone;
+    app->startup_ready_ms = esp32_cam_ai_startup_ms(app);
+    FURI_LOG_I(
+        TAG, "Link up %lu ms after launch, %lu STATUS sent", app->startup_ready_ms, app->handshake_attempts);
+}
+
+static void esp32_cam_ai_handshake_check_timeout(ESP32CamAI* app) {
+    if(app->handshake != ESP32CamAIHandshakeWaiting) return;
+    if((int32_t)(furi_get_tick() - app->handshake_deadline) < 0) return;
+    
+    if(app->handshake_attempts < HANDSHAKE_ATTEMPTS) {
+        esp32_cam_ai_handshake_send(app);
+        return;
+    }
+    
+    FURI_LOG_W(TAG, "No answer to %lu STATUS, sending commands anyway", app->handshake_attempts);
+    app->handshake = ESP32CamAIHandshakeFailed;
+    app->request = &app->requests[0];
+    esp32_cam_ai_response_set(app, "❌ ESP32-CAM not responding");
+    esp32_cam_ai_response_changed(app);
+}
+
+// Start over with the capability offers: flow control, then the framed link,
+// then tags, then a faster rate. The peer is in text mode at BAUDRATE here.
+static void esp32_cam_ai_link_offer(ESP32CamAI* app) {
+    app->link_flow = false;
+    app->link_framed = false;
+    app->link_tagged = false;
+    app->link_compressed = false;
+    app->link_archive = false;
+    app->link_archive_refused = false;
+    app->link_flow_window = app->flow_window;
+    
+    char command[24];
+    snprintf(command, sizeof(command), "FLOW:%lu", app->link_flow_window);
+    esp32_cam_ai_link_step_send(app, ESP32CamAILinkStepFlow, command);
+}
+
+static void esp32_cam_ai_response_ready(ESP32CamAI* app, const char* arg) {
+    UNUSED(arg);
+    esp32_cam_ai_response_set(app, "✅ ESP32-CAM Ready");
+    app->uart_connected = true;
+    esp32_cam_ai_handshake_done(app);
+    
+    // A (re)booted peer always starts in text mode at the default rate
+    if(app->baudrate != BAUDRATE) {
+        furi_hal_serial_set_br(app->main_link.serial_handle, BAUDRATE);
+        app->baudrate = BAUDRATE;
+    }
+    app->baud_state = ESP32CamAIBaudIdle;
+    
+    // Whatever was in flight died with the old session. A lookup in progress
+    // is failed once the cache thread gives its slot back.
+    app->requests[0].pending = false;
+    for(size_t i = 1; i <= REQUEST_INFLIGHT_MAX; i++) {
+        if(!app->requests[i].pending) continue;
+        if(esp32_cam_ai_cache_on_loan(&app->requests[i])) {
+            app->requests[i].pending = false;
+        } else {
+            esp32_cam_ai_request_fail(app, &app->requests[i], "ESP32-CAM restarted");
+        }
+    }
+    app->request = &app->requests[0];
+    esp32_cam_ai_link_offer(app);
+}
+
+static void esp32_cam_ai_response_flow(ESP32CamAI* app, const char* arg) {
+    if(app->link_step == ESP32CamAILinkStepFlow) {
+        esp32_cam_ai_link_step_done(app, strcmp(arg, "OK") == 0);
+    }
+}
+
+static void esp32_cam_ai_response_framed(ESP32CamAI* app, const char* arg) {
+    if(app->link_step == ESP32CamAILinkStepFramed) {
+        esp32_cam_ai_link_step_done(app, strcmp(arg, "OK") == 0);
+    }
+}
+
+static void esp32_cam_ai_response_tags(ESP32CamAI* app, const char* arg) {
+    if(app->link_step == ESP32CamAILinkStepTags) {
+        esp32_cam_ai_link_step_done(app, strcmp(arg, "OK") == 0);
+    }
+}
+
+static void esp32_cam_ai_response_compress(ESP32CamAI* app, const char* arg) {
+    if(app->link_step == ESP32CamAILinkStepCompress) {
+        esp32_cam_ai_link_step_done(app, strcmp(arg, "OK") == 0);
+    }
+}
+
+static void esp32_cam_ai_response_baud(ESP32CamAI* app, const char* arg) {
+    if(app->baud_state != ESP32CamAIBaudProposed || strcmp(arg, "OK") != 0) return;
+    
+    // The peer switches right after BAUD:OK; follow it and verify with an echo
+    furi_hal_serial_tx_wait_complete(app->main_link.serial_handle);
+    furi_hal_serial_set_br(app->main_link.serial_handle, app->baud_candidate);
+    furi_delay_ms(BAUD_SWITCH_DELAY_MS);
+    esp32_cam_ai_worker_send_line(app, "PING");
+    
+    app->baud_state = ESP32CamAIBaudVerifying;
+    app->baud_deadline = furi_get_tick() + furi_ms_to_ticks(BAUD_REPLY_TIMEOUT_MS);
+}
+
+static void esp32_cam_ai_response_pong(ESP32CamAI* app, const char* arg) {
+    UNUSED(arg);
+    if(app->baud_state != ESP32CamAIBaudVerifying) return;
+    
+    app->baudrate = app->baud_candidate;
+    __atomic_store_n(&app->baudrate_verified, app->baud_candidate, __ATOMIC_RELAXED);
+    app->baud_state = ESP32CamAIBaudIdle;
+    FURI_LOG_I(TAG, "Link running at %lu baud", app->baudrate);
+}
+
+static void esp32_cam_ai_response_recording(ESP32CamAI* app, const char* arg) {
+    UNUSED(arg);
+    esp32_cam_ai_response_set(app, "🎤 Recording audio...");
+    app->ptt_active = true;
+}
+
+static void esp32_cam_ai_response_processing(ESP32CamAI* app, const char* arg) {
+    UNUSED(arg);
+    esp32_cam_ai_response_set(app, "⚙️ Processing voice...");
+}
+
+static void esp32_cam_ai_response_flash(ESP32CamAI* app, const char* arg) {
+    if(strcmp(arg, "ON") == 0) {
+        esp32_cam_ai_response_set(app, "💡 Flash LED ON");
+        app->flash_status = true;
+    } else if(strcmp(arg, "OFF") == 0) {
+        esp32_cam_ai_response_set(app, "🔲 Flash LED OFF");
+        app->flash_status = false;
+    } else {
+        esp32_cam_ai_response_set(app, "📥 FLASH:%s", arg);
+    }
+}
+
+static void esp32_cam_ai_response_ok(ESP32CamAI* app, const char* arg) {
+    esp32_cam_ai_response_set(app, "✅ %s", arg);
+    app->ptt_active = false;
+}
+
+static void esp32_cam_ai_response_error(ESP32CamAI* app, const char* arg) {
+    // Link setup replies are never tagged, and offers are only made while no
+    // other untagged reply is due, so with none due this one is the offer's
+    bool setup = app->request == &app->requests[0] && esp32_cam_ai_link_quiet(app);
+    if(setup && app->link_step != ESP32CamAILinkStepNone) {
+        esp32_cam_ai_link_step_done(app, false);
+        return;
+    }
+    if(setup && app->baud_state == ESP32CamAIBaudProposed) {
+        esp32_cam_ai_link_baud_fallback(app);
+        return;
+    }
+    app->request->cache_line = NULL;
+    esp32_cam_ai_response_set(app, "❌ %s", arg);
+    app->ptt_active = false;
+}
+
+static void esp32_cam_ai_response_voice(ESP32CamAI* app, const char* arg) {
+    esp32_cam_ai_response_set(app, "🗣️ '%s'", arg);
+}
+
+static void esp32_cam_ai_response_status(ESP32CamAI* app, const char* arg) {
+    esp32_cam_ai_response_set(app, "ℹ️ %s", arg);
+    
+    // A peer that was up before the app started never sends READY, so its
+    // answer to the handshake is where the link setup starts
+    if(app->handshake != ESP32CamAIHandshakeDone) {
+        esp32_cam_ai_handshake_done(app);
+        esp32_cam_ai_link_offer(app);
+    }
+}
+
+// Append streamed text up to response_cap, decoding the \n and \\ escapes
+static void esp32_cam_ai_response_append(ESP32CamAI* app, ESP32CamAIRequest* request, const char* text) {
+    if(request->stream_truncated) return;
+    
+    while(*text) {
+        size_t size = request->text_size;
+        uint32_t cap = __atomic_load_n(&app->response_cap_active, __ATOMIC_RELAXED);
+        size_t room = size < cap ? cap - size : 0;
+        room = MIN(room, esp32_cam_ai_text_room(request));
+        if(room == 0) {
+            request->stream_truncated = true;
+            return;
+        }
+        
+        const char* escape = strchr(text, '\\');
+        size_t length = escape ? (size_t)(escape - text) : strlen(text);
+        if(length > room) {
+            // Never cut a UTF-8 sequence in half
+            length = room;
+            while(length > 0 && ((uint8_t)text[length] & 0xC0) == 0x80) length--;
+            request->stream_truncated = true;
+        }
+        esp32_cam_ai_text_append(app, request, text, length);
+        if(request->stream_truncated) return;
+        
+        text += length;
+        if(escape) {
+            char escaped = escape[1];
+            if(escaped == 'n') {
+                esp32_cam_ai_text_append(app, request, "\n", 1);
+            } else if(escaped != '\0') {
+                esp32_cam_ai_text_append(app, request, &escaped, 1);
+            }
+            text = escaped ? escape + 2 : escape + 1;
+        }
+    }
+}
+
+// First fragment of a streamed answer replaces the "Processing..." placeholder
+static void esp32_cam_ai_stream_begin(ESP32CamAI* app, uint32_t id) {
+    ESP32CamAIRequest* request = app->request;
+    esp32_cam_ai_response_set(app, "✅ ");
+    request->stream_id = id;
+    request->stream_active = true;
+    request->stream_truncated = false;
+    request->stream_base = request->text_size;
+    request->stream_start_tick = furi_get_tick();
+    request->stream_wire_bytes = 0;
+    memset(&request->lz, 0, sizeof(request->lz));
+}
+
+static void esp32_cam_ai_response_chunk(ESP32CamAI* app, const char* arg) {
+    ESP32CamAIRequest* request = app->request;
+    char* text;
+    uint32_t id = strtoul(arg, &text, 10);
+    if(text == arg || *text != ':') {
+        esp32_cam_ai_response_set(app, "📥 CHUNK:%s", arg);
+        return;
+    }
+    
+    if(!request->stream_active || id != request->stream_id) {
+        esp32_cam_ai_stream_begin(app, id);
+    }
+    
+    request->stream_wire_bytes += strlen(text + 1);
+    esp32_cam_ai_response_append(app, request, text + 1);
+}
+
+static void esp32_cam_ai_response_end(ESP32CamAI* app, const char* arg) {
+    ESP32CamAIRequest* request = app->request;
+    uint32_t id = strtoul(arg, NULL, 10);
+    if(!request->stream_active || id != request->stream_id) return;
+    
+    // Text against wire rate shows what compression buys on this link
+    uint32_t elapsed = furi_get_tick() - request->stream_start_tick;
+    uint32_t text_bytes = request->text_size - request->stream_base;
+    if(elapsed > 0) {
+        app->stream_text_rate = (uint64_t)text_bytes * furi_kernel_get_tick_frequency() / elapsed;
+        app->stream_wire_rate =
+            (uint64_t)request->stream_wire_bytes * furi_kernel_get_tick_frequency() / elapsed;
+    }
+    esp32_cam_ai_log_args(
+        app,
+        ESP32CamAILogAnswer,
+        request->id,
+        text_bytes,
+        request->stream_wire_bytes,
+        elapsed * 1000 / furi_kernel_get_tick_frequency());
+    
+    if(request->stream_truncated) {
+        esp32_cam_ai_text_append(app, request, "\n[truncated]", strlen("\n[truncated]"));
+        request->cache_line = NULL;
+    }
+    request->stream_active = false;
+    app->ptt_active = false;
+}
+
+// Decode LZ bits into the answer text, up to response_cap. At the cap a
+// UTF-8 sequence left incomplete is dropped again.
+static void esp32_cam_ai_lz_append(ESP32CamAI* app, const uint8_t* data, size_t size) {
+    ESP32CamAIRequest* request = app->request;
+    if(request->stream_truncated) return;
+    
+    uint32_t cap = __atomic_load_n(&app->response_cap_active, __ATOMIC_RELAXED);
+    size_t capacity = MIN(cap, request->arena_top - 1);
+    ESP32CamAILzResult result = esp32_cam_ai_lz_decode(
+        &request->lz, data, size, request->text, &request->text_size, request->stream_base, capacity);
+    if(result == ESP32CamAILzFull) esp32_cam_ai_text_trim_utf8(request, request->stream_base);
+    if(result != ESP32CamAILzOk) request->stream_truncated = true;
+    esp32_cam_ai_arena_update_peak(app, request);
+}
+
+// Time the first reply to a timed request, a line or an LZ frame
+static void esp32_cam_ai_stats_reply(ESP32CamAI* app, ESP32CamAIRequest* request) {
+    if(request->stats_command == ESP32CamAIStatsCount || request->stats_first_tick) return;
+    
+    request->stats_first_tick = furi_get_tick();
+    esp32_cam_ai_stats_record(
+        app, request->stats_command, ESP32CamAIStatsWait, request->stats_first_tick - request->stats_sent_tick);
+}
+
+// One LZ frame of a compressed answer. Frames carry their offset into the
+// stream so a lost one ends the answer instead of garbling it.
+static void esp32_cam_ai_lz_frame(ESP32CamAI* app, const uint8_t* data, size_t size) {
+    if(size < LZ_FRAME_HEADER_SIZE) return;
+    
+    ESP32CamAIRequest* request = esp32_cam_ai_request_find(app, data[0]);
+    uint32_t id = data[1] | (data[2] << 8) | (data[3] << 16) | ((uint32_t)data[4] << 24);
+    uint32_t offset = data[5] | (data[6] << 8) | (data[7] << 16) | ((uint32_t)data[8] << 24);
+    data += LZ_FRAME_HEADER_SIZE;
+    size -= LZ_FRAME_HEADER_SIZE;
+    
+    app->request = request;
+    uint32_t generation = request->generation;
+    size_t text_size = request->text_size;
+    esp32_cam_ai_stats_reply(app, request);
+    
+    if(!request->stream_active || id != request->stream_id) esp32_cam_ai_stream_begin(app, id);
+    if(offset != request->stream_wire_bytes) request->stream_truncated = true;
+    request->stream_wire_bytes += size;
+    esp32_cam_ai_lz_append(app, data, size);
+    
+    if(request->generation != generation || request->text_size != text_size) {
+        esp32_cam_ai_response_changed(app);
+    }
+}
+
+// PREVIEW:<width>:<height>:<MONO|GRAY>[:<frame id>] announces the pixels that
+// follow in image frames, which only the framed link can carry
+static void esp32_cam_ai_response_preview(ESP32CamAI* app, const char* arg) {
+    char* end;
+    uint32_t width = strtoul(arg, &end, 10);
+    uint32_t height = *end == ':' ? strtoul(end + 1, &end, 10) : 0;
+    const char* format = *end == ':' ? end + 1 : "";
+    
+    bool known = strncmp(format, "MONO", 4) == 0 || strncmp(format, "GRAY", 4) == 0;
+    if(known && format[4] != '\0' && format[4] != ':') known = false;
+    
+    if(width == 0 || width > PREVIEW_WIDTH || height == 0 || height > PREVIEW_HEIGHT || !known) {
+        esp32_cam_ai_response_set(app, "📥 PREVIEW:%s", arg);
+        return;
+    }
+    if(!app->link_framed) {
+        esp32_cam_ai_response_set(app, "❌ Preview needs the framed link");
+        return;
+    }
+    
+    app->preview_format = format[0] == 'M' ? ESP32CamAIPreviewMono : ESP32CamAIPreviewGray;
+    app->preview_width = width;
+    app->preview_height = height;
+    app->preview_size = app->preview_format == ESP32CamAIPreviewMono ? (width + 7) / 8 * height :
+                                                                       width * height;
+    app->preview_received = 0;
+    app->preview_decode_cycles = 0;
+    app->preview_start_tick = furi_get_tick();
+    app->preview_request_id = app->request->id;
+    app->preview_frame_id = format[4] == ':' ? strtoul(format + 5, NULL, 10) : 0;
+    app->preview_active = true;
+    esp32_cam_ai_dither_begin(&app->dither, app->preview_dither);
+    memset(app->preview_back, 0, PREVIEW_FB_SIZE);
+    
+    // Viewfinder frames keep the previous one on screen and leave the answer alone
+    if(app->viewfinder_running) return;
+    
+    with_view_model(
+        app->preview_view,
+        ESP32CamAIPreviewViewModel * model,
+        { model->status = "Receiving..."; },
+        true);
+    
+    esp32_cam_ai_response_set(app, "🖼️ Preview %lux%lu %.4s", width, height, format);
+}
+
+static void esp32_cam_ai_response_archive(ESP32CamAI* app, const char* arg) {
+    if(app->link_step == ESP32CamAILinkStepArchive) {
+        esp32_cam_ai_link_step_done(app, strcmp(arg, "OK") == 0);
+    }
+}
+
+// JPEG:<size> announces the capture of the request it is tagged with, sent
+// in JPEG frames while archiving is on
+static void esp32_cam_ai_response_jpeg(ESP32CamAI* app, const char* arg) {
+    uint32_t size = strtoul(arg, NULL, 10);
+    if(app->archive_jpeg_active) esp32_cam_ai_archive_jpeg_done(app, false);
+    if(!app->link_archive || !app->link_framed || size == 0 || size > ARCHIVE_JPEG_MAX) return;
+    
+    ESP32CamAIRequest* request = app->request;
+    if(request->archive_name[0] == '\0') esp32_cam_ai_archive_name(app, request);
+    
+    char name[ARCHIVE_NAME_SIZE + 4];
+    snprintf(name, sizeof(name), "%s.jpg", request->archive_name);
+    if(!esp32_cam_ai_archive_put(app, ESP32CamAIArchiveOpen, name, strlen(name))) {
+        app->archive_dropped++;
+        return;
+    }
+    app->archive_jpeg_active = true;
+    app->archive_jpeg_size = size;
+    app->archive_jpeg_received = 0;
+}
+
+#define RESPONSE_HANDLER(token, final, name) esp32_cam_ai_response_##name,
+
+// Handlers in the order of ESP32_CAM_AI_REPLIES, which lists the tokens
+static const ESP32CamAIResponseHandler esp32_cam_ai_response_handlers[] = {
+    ESP32_CAM_AI_REPLIES(RESPONSE_HANDLER)};
+
+// Handle one complete line received from the ESP32-CAM. Only the leading
+// token is matched, so answer text mentioning e.g. "ERROR:" is never misrouted.
+// A "#<id>:" tag routes the line to the request it answers.
+static void esp32_cam_ai_process_line(ESP32CamAI* app, const char* line) {
+    if(EVENT_LOG_VERBOSE) esp32_cam_ai_log_text(app, ESP32CamAILogRxLine, 0, line);
+    
+    bool tagged;
+    uint32_t id;
+    line = esp32_cam_ai_line_untag(line, &tagged, &id);
+    app->request = tagged ? esp32_cam_ai_request_find(app, id) : &app->requests[0];
+    ESP32CamAIRequest* request = app->request;
+    uint32_t generation = request->generation;
+    size_t size = request->text_size;
+    
+    const char* arg;
+    size_t reply = esp32_cam_ai_reply_match(line, &arg);
+    if(reply != ESP32_CAM_AI_REPLY_NONE) {
+        bool final = esp32_cam_ai_replies[reply].final;
+        esp32_cam_ai_stats_reply(app, request);
+        esp32_cam_ai_response_handlers[reply](app, arg);
+        if(final && request->stats_command != ESP32CamAIStatsCount &&
+           !request->stats_final_tick) {
+            request->stats_final_tick = furi_get_tick();
+            esp32_cam_ai_stats_record(
+                app,
+                request->stats_command,
+                ESP32CamAIStatsTransfer,
+                request->stats_final_tick - request->stats_first_tick);
+        }
+        if(final) {
+            request->pending = false;
+            esp32_cam_ai_trace_answer(app, request);
+            esp32_cam_ai_cache_put(app, request);
+            esp32_cam_ai_archive_answer(app, request);
+            esp32_cam_ai_broadcast_done(app, request);
+        }
+    } else if(strlen(line) > 2) {
+        // Any other response
+        esp32_cam_ai_response_set(app, "📥 %s", line);
+    }
+    
+    // Link setup replies leave the text alone and must not steal the focus
+    app->request = request;
+    if(request->generation != generation || request->text_size != size) {
+        esp32_cam_ai_response_changed(app);
+    }
+}
+
+// Replies of the second camera. It only ever answers a broadcast, so it gets
+// its own handlers that write to its slot and touch no state of the main
+// link: no handshake, link setup, push-to-talk or statistics.
+typedef void (*ESP32CamAISecondHandler)(ESP32CamAI* app, ESP32CamAIRequest* request, const char* arg);
+
+typedef struct {
+    const char* token;
+    uint8_t token_length;
+    bool final;
+    ESP32CamAISecondHandler handler;
+} ESP32CamAISecondResponse;
+
+#define RESPONSE(token, final, handler) {token, sizeof(token) - 1, final, handler}
+
+static void esp32_cam_ai_second_ok(ESP32CamAI* app, ESP32CamAIRequest* request, const char* arg) {
+    request->text_size = 0;
+    esp32_cam_ai_text_printf(app, request, "✅ %s", arg);
+}
+
+static void esp32_cam_ai_second_error(ESP32CamAI* app, ESP32CamAIRequest* request, const char* arg) {
+    request->text_size = 0;
+    esp32_cam_ai_text_printf(app, request, "❌ %s", arg);
+}
+
+static void esp32_cam_ai_second_chunk(ESP32CamAI* app, ESP32CamAIRequest* request, const char* arg) {
+    char* text;
+    uint32_t id = strtoul(arg, &text, 10);
+    if(text == arg || *text != ':') return;
+    
+    if(!request->stream_active || id != request->stream_id) {
+        request->text_size = 0;
+        esp32_cam_ai_text_printf(app, request, "✅ ");
+        request->stream_id = id;
+        request->stream_active = true;
+        request->stream_truncated = false;
+    }
+    esp32_cam_ai_response_append(app, request, text + 1);
+}
+
+static void esp32_cam_ai_second_end(ESP32CamAI* app, ESP32CamAIRequest* request, const char* arg) {
+    if(!request->stream_active || strtoul(arg, NULL, 10) != request->stream_id) return;
+    
+    if(request->stream_truncated) {
+        esp32_cam_ai_text_append(app, request, "\n[truncated]", strlen("\n[truncated]"));
+    }
+    request->stream_active = false;
+}
+
+static const ESP32CamAISecondResponse esp32_cam_ai_second_responses[] = {
+    RESPONSE("OK", true, esp32_cam_ai_second_ok),
+    RESPONSE("ERROR", true, esp32_cam_ai_second_error),
+    RESPONSE("CHUNK", false, esp32_cam_ai_second_chunk),
+    RESPONSE("END", true, esp32_cam_ai_second_end),
+};
+
+// Handle one line from the second camera. Only replies to a pending broadcast
+// count; its READY banner, STATUS and anything unasked for are dropped.
+static void esp32_cam_ai_second_line(ESP32CamAI* app, const char* line) {
+    ESP32CamAIRequest* request = &app->requests[REQUEST_SECOND_SLOT];
+    if(!request->pending) return;
+    
+    const char* colon = strchr(line, ':');
+    size_t token_length = colon ? (size_t)(colon - line) : strlen(line);
+    for(size_t i = 0; i < COUNT_OF(esp32_cam_ai_second_responses); i++) {
+        const ESP32CamAISecondResponse* response = &esp32_cam_ai_second_responses[i];
+        if(response->token_length != token_length || memcmp(response->token, line, token_length) != 0) {
+            continue;
+        }
+        
+        response->handler(app, request, colon ? colon + 1 : "");
+        if(response->final) {
+            request->pending = false;
+            esp32_cam_ai_broadcast_done(app, request);
+        }
+        return;
+    }
+}
+
+// Account a finished or failed viewfinder frame and schedule the next one
+static void esp32_cam_ai_viewfinder_frame_done(ESP32CamAI* app, bool complete) {
+    uint32_t now = furi_get_tick();
+    app->viewfinder_waiting = false;
+    
+    if(complete) {
+        app->viewfinder_window_frames++;
+        uint32_t window = now - app->viewfinder_window_tick;
+        if(window >= furi_ms_to_ticks(1000)) {
+            app->viewfinder_fps_x10 =
+                app->viewfinder_window_frames * 10 * furi_kernel_get_tick_frequency() / window;
+            app->viewfinder_window_frames = 0;
+            app->viewfinder_window_tick = now;
+        }
+    } else {
+        app->viewfinder_dropped++;
+    }
+    
+    // Pace to what the link just delivered
+    uint32_t round_trip = now - app->viewfinder_request_tick;
+    app->viewfinder_next_tick =
+        app->viewfinder_request_tick +
+        MAX(round_trip * 5 / 4, furi_ms_to_ticks(VIEWFINDER_MIN_INTERVAL_MS));
+}
+
+// Finish the current preview: show the back buffer if it is complete and
+// report on the request that asked for it, or just count it for the viewfinder
+static void esp32_cam_ai_preview_done(ESP32CamAI* app, const char* status) {
+    app->preview_active = false;
+    if(app->viewfinder_running) esp32_cam_ai_viewfinder_frame_done(app, status == NULL);
+    
+    uint32_t transfer_ms =
+        (furi_get_tick() - app->preview_start_tick) * 1000 / furi_kernel_get_tick_frequency();
+    uint32_t decode_us =
+        app->preview_decode_cycles / furi_hal_cortex_instructions_per_microsecond();
+    uint32_t pixels = app->preview_width * app->preview_height;
+    uint32_t cpp_x10 = (uint32_t)((uint64_t)app->preview_decode_cycles * 10 / pixels);
+    
+    with_view_model(
+        app->preview_view,
+        ESP32CamAIPreviewViewModel * model,
+        {
+            if(!status) {
+                uint8_t* front = model->framebuffer;
+                model->framebuffer = app->preview_back;
+                app->preview_back = front;
+                model->valid = true;
+                model->width = app->preview_width;
+                model->height = app->preview_height;
+                model->frame_id = app->preview_frame_id;
+                model->transfer_ms = transfer_ms;
+                model->decode_us = decode_us;
+                model->decode_cpp_x10 = cpp_x10;
+            }
+            if(!status || !app->viewfinder_running) model->status = status;
+            model->fps_x10 = app->viewfinder_fps_x10;
+            model->dropped = app->viewfinder_dropped;
+        },
+        true);
+    
+    if(app->viewfinder_running) return;
+    
+    app->request = esp32_cam_ai_request_find(app, app->preview_request_id);
+    if(status) {
+        esp32_cam_ai_response_set(app, "❌ Preview: %s", status);
+    } else {
+        esp32_cam_ai_text_printf(
+            app,
+            app->request,
+            "\n⏱️ %lu ms transfer, %lu us decode (%lu.%lu cycles/px)",
+            transfer_ms,
+            decode_us,
+            cpp_x10 / 10,
+            cpp_x10 % 10);
+        FURI_LOG_I(
+            TAG,
+            "Preview %ux%u: %lu bytes, %lu ms transfer, %lu us decode, %lu.%lu cycles/px",
+            app->preview_width,
+            app->preview_height,
+            app->preview_size,
+            transfer_ms,
+            decode_us,
+            cpp_x10 / 10,
+            cpp_x10 % 10);
+    }
+    esp32_cam_ai_response_changed(app);
+}
+
+// Map one image frame into the back buffer as it arrives, so the full
+// frame is never held anywhere in its source format
+static void esp32_cam_ai_preview_decode(ESP32CamAI* app, const uint8_t* data, size_t size) {
+    if(!app->preview_active || size < 2) return;
+    
+    uint32_t offset = data[0] | (data[1] << 8);
+    data += 2;
+    size -= 2;
+    if(offset != app->preview_received || size > app->preview_size - offset) {
+        // A lost frame leaves a hole that in-order decoding cannot fill
+        esp32_cam_ai_preview_done(app, "Frame lost");
+        return;
+    }
+    
+    uint32_t start = DWT->CYCCNT;
+    uint32_t width = app->preview_width;
+    uint32_t x0 = (PREVIEW_WIDTH - width) / 2;
+    uint32_t y0 = (PREVIEW_HEIGHT - app->preview_height) / 2;
+    uint8_t* framebuffer = app->preview_back;
+    
+    if(app->preview_format == ESP32CamAIPreviewMono) {
+        uint32_t stride = (width + 7) / 8;
+        uint32_t row = offset / stride;
+        uint32_t column = offset % stride;
+        for(size_t i = 0; i < size; i++) {
+            uint8_t* line = framebuffer + (y0 + row) * PREVIEW_STRIDE;
+            for(uint32_t bit = 0; bit < 8 && column * 8 + bit < width; bit++) {
+                if(data[i] & (0x80 >> bit)) {
+                    uint32_t x = x0 + column * 8 + bit;
+                    line[x >> 3] |= 1 << (x & 7);
+                }
+            }
+            if(++column == stride) {
+                column = 0;
+                row++;
+            }
+        }
+    } else {
+        uint32_t row = offset / width;
+        uint32_t column = offset % width;
+        for(size_t left = size; left > 0;) {
+            size_t run = MIN(left, width - column);
+            esp32_cam_ai_dither_run(
+                &app->dither, data, run, row, column, framebuffer + (y0 + row) * PREVIEW_STRIDE, x0);
+            data += run;
+            left -= run;
+            column += run;
+            if(column == width) {
+                column = 0;
+                row++;
+            }
+        }
+    }
+    
+    app->preview_decode_cycles += DWT->CYCCNT - start;
+    app->preview_received += size;
+    if(app->preview_received == app->preview_size) {
+        esp32_cam_ai_preview_done(app, NULL);
+    }
+}
+
+// Decode, check and dispatch one NUL-terminated frame from line_buffer. Bad
+// frames are counted and dropped.
+static void esp32_cam_ai_process_frame(ESP32CamAI* app, uint8_t* data, size_t size) {
+    // A rebooted peer talks text again; its READY banner is too short to be a frame
+    const char* line = (const char*)data;
+    if(strcmp(line, "READY") == 0 || strcmp(line, "READY\r") == 0) {
+        app->link_framed = false;
+        esp32_cam_ai_process_line(app, "READY");
+        return;
+    }
+    
+    size_t payload_length;
+    if(!esp32_cam_ai_frame_decode(data, size, &payload_length)) {
+        app->frames_bad++;
+        return;
+    }
+    app->frames_ok++;
+    
+    uint8_t* payload = data + FRAME_HEADER_SIZE;
+    switch(data[0]) {
+        case ESP32CamAIFrameText:
+            payload[payload_length] = '\0';
+            esp32_cam_ai_process_line(app, (const char*)payload);
+            break;
+        case ESP32CamAIFrameImage:
+            esp32_cam_ai_preview_decode(app, payload, payload_length);
+            break;
+        case ESP32CamAIFrameJpeg:
+            esp32_cam_ai_archive_jpeg_data(app, payload, payload_length);
+            break;
+        case ESP32CamAIFrameLz:
+            esp32_cam_ai_lz_frame(app, payload, payload_length);
+            break;
+        default:
+            esp32_cam_ai_log_args(app, ESP32CamAILogUnknownFrame, 0, data[0], 0, 0);
+            break;
+    }
+}
+
+// Split a received block into lines. The unterminated tail stays in the
+// link's line_buffer until the next block; overlong lines are truncated.
+// The mode is looked at again for every line, since FRAMED:OK or a READY
+// fallback can switch it with the rest of the block still to come.
+static void esp32_cam_ai_frame_lines(
+    ESP32CamAI* app,
+    ESP32CamAILink* link,
+    const uint8_t* data,
+    size_t size) {
+    bool main = link == &app->main_link;
+    
+    while(size > 0) {
+        bool framed = main && app->link_framed;
+        bool complete;
+        size_t taken = esp32_cam_ai_line_take(
+            link->line_buffer, &link->line_length, framed, data, size, &complete);
+        data += taken;
+        size -= taken;
+        
+        // Counted before the line is handled, so FLOW:OK can start from zero
+        if(main) app->flow_consumed += taken;
+        if(!complete) break;
+        
+        if(link->line_length > 0) {
+            if(!main) {
+                esp32_cam_ai_second_line(app, link->line_buffer);
+            } else if(framed) {
+                esp32_cam_ai_process_frame(app, (uint8_t*)link->line_buffer, link->line_length);
+            } else {
+                esp32_cam_ai_process_line(app, link->line_buffer);
+            }
+            link->line_length = 0;
+        }
+    }
+}
+
+// Send the command of a started request over the link
+static void esp32_cam_ai_request_send(
+    ESP32CamAI* app,
+    ESP32CamAIRequest* request,
+    const char* command,
+    size_t question_offset,
+    uint32_t queued_tick) {
+    esp32_cam_ai_trace_put(app, ESP32CamAITraceCommand, command, strlen(command));
+    if(app->link_archive && esp32_cam_ai_archive_captures(command)) {
+        esp32_cam_ai_archive_name(app, request);
+    }
+    
+    request->stats_command = esp32_cam_ai_stats_classify(command);
+    request->stats_sent_tick = furi_get_tick();
+    esp32_cam_ai_stats_record(
+        app, request->stats_command, ESP32CamAIStatsQueue, request->stats_sent_tick - queued_tick);
+    
+    if(request->id) {
+        // A fresh arena always has room for this, REQUEST_ARENA_EXTRA covers it
+        const char* line = esp32_cam_ai_arena_printf(app, request, "#%u:%s", request->id, command);
+        furi_check(line);
+        esp32_cam_ai_worker_send_line(app, line);
+    } else {
+        esp32_cam_ai_worker_send_line(app, command);
+    }
+    esp32_cam_ai_log_text(app, ESP32CamAILogTxCommand, request->id, command);
+    esp32_cam_ai_broadcast_begin(app, request, command);
+    if(!app->startup_command_ms && app->handshake == ESP32CamAIHandshakeDone) {
+        app->startup_command_ms = esp32_cam_ai_startup_ms(app);
+    }
+    
+    app->request = request;
+    if(question_offset) {
+        esp32_cam_ai_response_set(app, "📤 Question: %s\nProcessing...", command + question_offset);
+    } else {
+        esp32_cam_ai_response_set(app, "📤 Sent: %s\nWaiting for response...", command);
+    }
+    esp32_cam_ai_response_changed(app);
+}
+
+// Transmit a queued command as a new request and focus it. Cacheable ones
+// are looked up first, with the slot on loan to the cache thread.
+static void esp32_cam_ai_worker_transmit(ESP32CamAI* app, const ESP32CamAICommand* command) {
+    ESP32CamAIRequest* request = esp32_cam_ai_request_start(app);
+    if(!request) {
+        esp32_cam_ai_trace_put(app, ESP32CamAITraceCommand, command->line, strlen(command->line));
+        app->request = &app->requests[0];
+        esp32_cam_ai_response_set(app, "❌ Too many requests in flight");
+        esp32_cam_ai_response_changed(app);
+        return;
+    }
+    
+    app->request = request;
+    app->request_focus = request - app->requests;
+    
+    if(command->cached) {
+        esp32_cam_ai_trace_put(
+            app, ESP32CamAITraceCommandCached, command->line, strlen(command->line));
+        request->pending = false;
+        esp32_cam_ai_response_set(app, "(cached when traced)\n💾 Cached");
+        esp32_cam_ai_response_changed(app);
+        return;
+    }
+    if(command->cacheable) {
+        request->cache_line = esp32_cam_ai_arena_printf(app, request, "%s", command->line);
+        
+        // Until the lookup is back the sent tick holds the queued one
+        request->stats_sent_tick = command->queued_tick;
+        if(request->cache_line &&
+           esp32_cam_ai_cache_lend(app, request, ESP32CamAICacheOpLookup, ESP32CamAICacheLoanLookup)) {
+            return;
+        }
+    }
+    esp32_cam_ai_request_send(
+        app, request, command->line, command->question_offset, command->queued_tick);
+}
+
+// Take back slots whose cache lookup is done. A hit is the answer, a miss
+// goes out to the peer now. Worker thread only.
+static void esp32_cam_ai_cache_collect(ESP32CamAI* app) {
+    for(size_t i = 0; i <= REQUEST_INFLIGHT_MAX; i++) {
+        ESP32CamAIRequest* request = &app->requests[i];
+        uint32_t loan = __atomic_load_n(&request->cache_loan, __ATOMIC_ACQUIRE);
+        if(loan != ESP32CamAICacheLoanHit && loan != ESP32CamAICacheLoanMiss) continue;
+        __atomic_store_n(&request->cache_loan, ESP32CamAICacheLoanNone, __ATOMIC_RELAXED);
+        
+        const char* line = request->cache_line;
+        app->request = request;
+        if(loan == ESP32CamAICacheLoanHit) {
+            // Answered from the cache, the link is not involved
+            esp32_cam_ai_trace_put(app, ESP32CamAITraceCommandCached, line, strlen(line));
+            request->pending = false;
+            request->cache_line = NULL;
+            esp32_cam_ai_text_printf(app, request, "\n💾 Cached");
+            request->generation = ++app->response_generation;
+            esp32_cam_ai_response_changed(app);
+        } else if(!request->pending) {
+            // The peer restarted during the lookup
+            esp32_cam_ai_trace_put(app, ESP32CamAITraceCommand, line, strlen(line));
+            request->cache_line = NULL;
+            esp32_cam_ai_request_fail(app, request, "ESP32-CAM restarted");
+        } else {
+            const char* colon = strchr(line, ':');
+            esp32_cam_ai_request_send(
+                app, request, line, colon ? (size_t)(colon + 1 - line) : 0, request->stats_sent_tick);
+        }
+    }
+}
+
+// Report what the worker has consumed once a quarter of the window has
+// been, so credits cost little TX. CREDIT: carries the running total, so a
+// lost one is made up by the next. Worker thread only.
+static void esp32_cam_ai_flow_grant(ESP32CamAI* app) {
+    // A credit sent while the rate changes could land at the wrong one
+    if(!app->link_flow || app->baud_state != ESP32CamAIBaudIdle) return;
+    
+    uint32_t consumed = app->flow_consumed - app->flow_credited;
+    if(consumed < app->link_flow_window / 4) return;
+    if(consumed >= app->link_flow_window) app->flow_pauses++;
+    
+    char command[24];
+    snprintf(command, sizeof(command), "CREDIT:%lu", app->flow_consumed);
+    esp32_cam_ai_worker_send_line(app, command);
+    app->flow_credited = app->flow_consumed;
+}
+
+// Request the next viewfinder frame when it is due. An outstanding frame is
+// still waited for after the viewfinder is turned off. Worker thread only.
+static void esp32_cam_ai_viewfinder_poll(ESP32CamAI* app) {
+    uint32_t now = furi_get_tick();
+    bool enabled = app->viewfinder_enabled && app->link_framed;
+    
+    if(!app->viewfinder_running) {
+        if(!enabled) return;
+        app->viewfinder_running = true;
+        app->viewfinder_waiting = false;
+        app->viewfinder_next_tick = now;
+        app->viewfinder_window_tick = now;
+        app->viewfinder_window_frames = 0;
+        app->viewfinder_fps_x10 = 0;
+        app->viewfinder_dropped = 0;
+    }
+    
+    if(app->viewfinder_waiting) {
+        if(now - app->viewfinder_request_tick < furi_ms_to_ticks(VIEWFINDER_TIMEOUT_MS)) return;
+        
+        // The header or part of the data never arrived
+        app->preview_active = false;
+        esp32_cam_ai_viewfinder_frame_done(app, false);
+        with_view_model(
+            app->preview_view,
+            ESP32CamAIPreviewViewModel * model,
+            { model->dropped = app->viewfinder_dropped; },
+            true);
+    }
+    
+    if(!enabled) {
+        app->viewfinder_running = false;
+        return;
+    }
+    if((int32_t)(now - app->viewfinder_next_tick) >= 0 && esp32_cam_ai_link_idle(app) &&
+       !app->requests[0].pending) {
+        esp32_cam_ai_worker_send_line(app, "PREVIEW");
+        app->viewfinder_waiting = true;
+        app->viewfinder_request_tick = now;
+    }
+}
+
+// Ticks until the worker has to wake up by itself: a deferred redraw, a
+// link negotiation step, a request timing out or the next viewfinder frame
+static uint32_t esp32_cam_ai_worker_timeout(ESP32CamAI* app, uint32_t timeout) {
+    timeout = esp32_cam_ai_response_flush_timeout(app, timeout);
+    uint32_t now = furi_get_tick();
+    
+    if(app->baud_state != ESP32CamAIBaudIdle) {
+        int32_t left = (int32_t)(app->baud_deadline - now);
+        timeout = MIN(timeout, left > 0 ? (uint32_t)left : 0);
+    }
+    if(app->link_step != ESP32CamAILinkStepNone) {
+        int32_t left = (int32_t)(app->link_step_deadline - now);
+        timeout = MIN(timeout, left > 0 ? (uint32_t)left : 0);
+    }
+    if(app->handshake == ESP32CamAIHandshakeWaiting) {
+        int32_t left = (int32_t)(app->handshake_deadline - now);
+        timeout = MIN(timeout, left > 0 ? (uint32_t)left : 0);
+    }
+    for(size_t i = 0; i < COUNT_OF(app->requests); i++) {
+        if(!app->requests[i].pending || esp32_cam_ai_cache_on_loan(&app->requests[i])) continue;
+        int32_t left = (int32_t)(app->requests[i].deadline - now);
+        timeout = MIN(timeout, left > 0 ? (uint32_t)left : 0);
+    }
+    // A frame that is due waits for the link to go idle, which has its own deadline
+    if(app->viewfinder_running &&
+       (app->viewfinder_waiting || (esp32_cam_ai_link_idle(app) && !app->requests[0].pending))) {
+        uint32_t due = app->viewfinder_waiting ?
+                           app->viewfinder_request_tick + furi_ms_to_ticks(VIEWFINDER_TIMEOUT_MS) :
+                           app->viewfinder_next_tick;
+        int32_t left = (int32_t)(due - now);
+        timeout = MIN(timeout, left > 0 ? (uint32_t)left : 0);
+    }
+    return timeout;
+}
+
+// Handle a block of received bytes, counting what it costs
+static void esp32_cam_ai_worker_rx(ESP32CamAI* app, ESP32CamAILink* link, size_t size) {
+    uint32_t start = DWT->CYCCNT;
+    esp32_cam_ai_frame_lines(app, link, app->rx_chunk, size);
+    app->parse_cycles += DWT->CYCCNT - start;
+    app->parse_bytes += size;
+}
+
+// Work the worker does after every batch of input
+static void esp32_cam_ai_worker_housekeeping(ESP32CamAI* app) {
+    esp32_cam_ai_flow_grant(app);
+    esp32_cam_ai_handshake_check_timeout(app);
+    esp32_cam_ai_link_check_timeout(app);
+    esp32_cam_ai_request_check_timeouts(app);
+}
+
+// Replay one trace command as if the GUI had just queued it. Answers that
+// came from the cache are stood in for, the cache itself is left alone.
+static void esp32_cam_ai_trace_replay_command(ESP32CamAI* app, bool cached) {
+    ESP32CamAICommand* command = &app->tx_command;
+    const char* colon = strchr(command->line, ':');
+    command->question_offset =
+        strncmp(command->line, "CUSTOM_", 7) == 0 && colon ? (size_t)(colon + 1 - command->line) : 0;
+    command->cacheable = false;
+    command->cached = cached;
+    command->queued_tick = furi_get_tick();
+    esp32_cam_ai_worker_transmit(app, command);
+}
+
+// Compare the oldest replayed answer with the one the trace recorded
+static void esp32_cam_ai_trace_replay_answer(ESP32CamAI* app, const uint8_t* record) {
+    uint32_t hash = record[1] | (record[2] << 8) | (record[3] << 16) | ((uint32_t)record[4] << 24);
+    
+    app->trace_checked++;
+    if(app->trace_answer_count == 0) return;
+    if(app->trace_answers[0] == hash) app->trace_matched++;
+    app->trace_answer_count--;
+    memmove(app->trace_answers, app->trace_answers + 1, app->trace_answer_count * sizeof(uint32_t));
+}
+
+// Feed TRACE_PATH through the worker instead of the UART: RX blocks go to
+// the line framer, traced commands to worker_transmit, and every answer is
+// checked against the hash the capture recorded. Ends with a summary in
+// slot 0. Worker thread only, before the main loop.
+static void esp32_cam_ai_trace_replay(ESP32CamAI* app, bool timed) {
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    File* file = storage_file_alloc(storage);
+    char magic[TRACE_MAGIC_SIZE];
+    bool ok = storage_file_open(file, TRACE_PATH, FSAM_READ, FSOM_OPEN_EXISTING) &&
+              storage_file_read(file, magic, sizeof(magic)) == sizeof(magic) &&
+              memcmp(magic, TRACE_MAGIC, sizeof(magic)) == 0;
+    
+    app->trace_replaying = true;
+    app->trace_answer_count = 0;
+    uint32_t start = furi_get_tick();
+    uint32_t rx_bytes = 0;
+    uint8_t header[TRACE_RECORD_HEADER_SIZE];
+    
+    while(ok && storage_file_read(file, header, sizeof(header)) == sizeof(header)) {
+        uint32_t tick = header[1] | (header[2] << 8) | (header[3] << 16) | ((uint32_t)header[4] << 24);
+        size_t length = header[5] | (header[6] << 8);
+        app->trace_bytes += sizeof(header) + length;
+        
+        if(timed) {
+            int32_t delay = (int32_t)(start + tick - furi_get_tick());
+            if(delay > 0) {
+                furi_thread_flags_wait(
+                    ESP32CamAIWorkerEventStop, FuriFlagWaitAny | FuriFlagNoClear, delay);
+            }
+        }
+        if(furi_thread_flags_get() & ESP32CamAIWorkerEventStop) break;
+        
+        switch(header[0]) {
+            case ESP32CamAITraceRx:
+                ok = length <= sizeof(app->rx_chunk) &&
+                     storage_file_read(file, app->rx_chunk, length) == length;
+                if(ok) esp32_cam_ai_worker_rx(app, &app->main_link, length);
+                rx_bytes += length;
+                break;
+            case ESP32CamAITraceCommand:
+            case ESP32CamAITraceCommandCached:
+                ok = length < sizeof(app->tx_command.line) &&
+                     storage_file_read(file, app->tx_command.line, length) == length;
+                app->tx_command.line[ok ? length : 0] = '\0';
+                if(ok) esp32_cam_ai_trace_replay_command(app, header[0] == ESP32CamAITraceCommandCached);
+                break;
+            case ESP32CamAITraceAnswer: {
+                uint8_t record[5];
+                ok = length == sizeof(record) && storage_file_read(file, record, length) == length;
+                if(ok) esp32_cam_ai_trace_replay_answer(app, record);
+                break;
+            }
+            default:
+                // TX only documents the capture; the replay's own TX goes nowhere
+                ok = storage_file_seek(file, length, false);
+                break;
+        }
+        esp32_cam_ai_worker_housekeeping(app);
+        esp32_cam_ai_link_publish(app);
+        esp32_cam_ai_response_flush(app);
+    }
+    
+    // Answers the capture never saw count against the replay too
+    app->trace_checked += app->trace_answer_count;
+    app->trace_answer_count = 0;
+    app->trace_replaying = false;
+    storage_file_close(file);
+    storage_file_free(file);
+    furi_record_close(RECORD_STORAGE);
+    
+    uint32_t ms = (furi_get_tick() - start) * 1000 / furi_kernel_get_tick_frequency();
+    uint32_t rate = ms ? (uint32_t)((uint64_t)rx_bytes * 1000 / ms) : 0;
+    FURI_LOG_I(
+        TAG,
+        "Replay %s: %lu B RX in %lu ms (%lu B/s), %lu/%lu answers match",
+        ok ? "done" : "failed",
+        rx_bytes,
+        ms,
+        rate,
+        app->trace_matched,
+        app->trace_checked);
+    
+    app->request = &app->requests[0];
+    esp32_cam_ai_response_set(
+        app,
+        "%s Replay%s\n%lu B RX in %lu ms\n%lu B/s\n%lu/%lu answers match",
+        ok && app->trace_matched == app->trace_checked ? "✅" : "❌",
+        ok ? "" : " stopped: bad trace",
+        rx_bytes,
+        ms,
+        rate,
+        app->trace_matched,
+        app->trace_checked);
+    esp32_cam_ai_response_changed(app);
+}
+
+// Commands picked after a replay have no peer to go to: the real one was
+// never brought up and its RX is off
+static void esp32_cam_ai_trace_refuse(ESP32CamAI* app) {
+    app->request = &app->requests[0];
+    app->request_focus = 0;
+    esp32_cam_ai_response_set(
+        app, "❌ Replay session\nTurn UART Trace off and restart the app to use the ESP32-CAM");
+    esp32_cam_ai_response_changed(app);
+}
+
+static int32_t esp32_cam_ai_worker(void* context) {
+    ESP32CamAI* app = (ESP32CamAI*)context;
+    
+    FURI_LOG_I(TAG, "Worker thread started");
+    
+    app->main_link.line_length = 0;
+    app->second_link.line_length = 0;
+    app->broadcast_active = false;
+    app->ui_pending = false;
+    app->ui_last_post_tick = furi_get_tick();
+    app->link_framed = false;
+    app->link_tagged = false;
+    app->link_step = ESP32CamAILinkStepNone;
+    esp32_cam_ai_link_publish(app);
+    app->baud_state = ESP32CamAIBaudIdle;
+    app->baudrate_target = __atomic_load_n(&app->baudrate_requested, __ATOMIC_RELAXED);
+    app->frames_ok = 0;
+    app->frames_bad = 0;
+    app->preview_active = false;
+    app->viewfinder_running = false;
+    app->link_compressed = false;
+    app->link_flow = false;
+    app->flow_consumed = 0;
+    app->flow_credited = 0;
+    app->parse_cycles = 0;
+    app->parse_bytes = 0;
+    app->log_head = 0;
+    app->worker_start_tick = furi_get_tick();
+    app->worker_wakeups = 0;
+    app->worker_idle_wakeups = 0;
+    app->link_archive = false;
+    app->link_archive_refused = false;
+    app->archive_jpeg_active = false;
+    // Tags start over with every session, so a replay hands out the same
+    // ones its capture did
+    for(size_t i = 0; i < COUNT_OF(app->requests); i++) {
+        app->requests[i].pending = false;
+        app->requests[i].id = 0;
+        app->requests[i].cache_loan = ESP32CamAICacheLoanNone;
+    }
+    app->request_next_id = 1;
+    app->request = &app->requests[0];
+    app->handshake = ESP32CamAIHandshakeWaiting;
+    app->handshake_attempts = 0;
+    
+    app->trace_capturing = false;
+    app->trace_replaying = false;
+    if(app->trace_session == ESP32CamAITraceCapture) {
+        esp32_cam_ai_archive_start(app);
+        esp32_cam_ai_trace_begin(app);
+    } else if(esp32_cam_ai_trace_is_replay(app)) {
+        app->handshake = ESP32CamAIHandshakeDone;
+        esp32_cam_ai_trace_replay(app, app->trace_session == ESP32CamAITraceReplay);
+    }
+    
+    // The peer may still be booting; ask until it answers rather than
+    // guessing how long that takes
+    if(app->handshake == ESP32CamAIHandshakeWaiting) {
+        esp32_cam_ai_handshake_send(app);
+    }
+    
+    while(1) {
+        // Sleep until RX data, a queued command, a setting change or stop.
+        // Only a deadline that is actually pending wakes it by itself.
+        uint32_t events = furi_thread_flags_wait(
+            WORKER_EVENTS_ALL, FuriFlagWaitAny, esp32_cam_ai_worker_timeout(app, FuriWaitForever));
+        if(events & FuriFlagError) events = 0;
+        app->worker_wakeups++;
+        if(!events) app->worker_idle_wakeups++;
+        
+        // Check if thread should exit
+        if(events & ESP32CamAIWorkerEventStop) {
+            esp32_cam_ai_link_reset(app);
+            break;
+        }
+        
+        // A new rate is taken only when it is chosen, so one the peer turned
+        // down is not offered again on every pass
+        if(events & ESP32CamAIWorkerEventBaud) {
+            app->baudrate_target = __atomic_load_n(&app->baudrate_requested, __ATOMIC_RELAXED);
+        }
+        esp32_cam_ai_cache_collect(app);
+        
+        // Drain whatever is pending in blocks. Untagged replies all go to
+        // slot 0, so they wait in the stream while it is on loan.
+        size_t ret;
+        while(!esp32_cam_ai_cache_on_loan(&app->requests[0]) &&
+              (ret = furi_stream_buffer_receive(
+                   app->main_link.rx_stream, app->rx_chunk, sizeof(app->rx_chunk), 0)) > 0) {
+            esp32_cam_ai_trace_put(app, ESP32CamAITraceRx, app->rx_chunk, ret);
+            esp32_cam_ai_worker_rx(app, &app->main_link, ret);
+        }
+        while(app->second_link.rx_stream &&
+              (ret = furi_stream_buffer_receive(
+                   app->second_link.rx_stream, app->rx_chunk, sizeof(app->rx_chunk), 0)) > 0) {
+            esp32_cam_ai_worker_rx(app, &app->second_link, ret);
+        }
+        esp32_cam_ai_worker_housekeeping(app);
+        esp32_cam_ai_viewfinder_poll(app);
+        
+        // Either waits while an untagged reply is due, so both are retried here
+        esp32_cam_ai_link_sync_archive(app);
+        esp32_cam_ai_link_negotiate_baud(app);
+        
+        // Commands stay queued through the handshake and any negotiation,
+        // and go out in the same pass the link becomes idle. An untagged
+        // link has only slot 0, so they also wait while it is on loan.
+        while(esp32_cam_ai_link_idle(app) && !esp32_cam_ai_cache_on_loan(&app->requests[0]) &&
+              furi_message_queue_get(app->tx_queue, &app->tx_command, 0) == FuriStatusOk) {
+            if(esp32_cam_ai_trace_is_replay(app)) {
+                esp32_cam_ai_trace_refuse(app);
+            } else {
+                esp32_cam_ai_worker_transmit(app, &app->tx_command);
+            }
+        }
+        esp32_cam_ai_link_publish(app);
+        esp32_cam_ai_response_flush(app);
+    }
+    
+    esp32_cam_ai_trace_end(app);
+    FURI_LOG_I(TAG, "Worker thread stopped");
+    return 0;
+}
+
+// Worker wakeups per second since it started, times 10
+uint32_t esp32_cam_ai_worker_wakeup_rate_x10(ESP32CamAI* app, uint32_t wakeups) {
+    uint32_t ticks = furi_get_tick() - app->worker_start_tick;
+    return ticks ? (uint32_t)((uint64_t)wakeups * 10 * furi_kernel_get_tick_frequency() / ticks) : 0;
+}
+
+// Worker cycles per received byte, times 10, 0 before anything arrived
+uint32_t esp32_cam_ai_parse_cost_x10(ESP32CamAI* app) {
+    return app->parse_bytes ? (uint32_t)(app->parse_cycles * 10 / app->parse_bytes) : 0;
+}
+
+// Acquire the UART of `link` and give it an RX stream. Reception starts later.
+static bool esp32_cam_ai_link_acquire(ESP32CamAILink* link) {
+    link->serial_handle = furi_hal_serial_control_acquire(link->serial_id);
+    if(!link->serial_handle) return false;
+    
+    link->rx_stream = furi_stream_buffer_alloc(RX_STREAM_SIZE, 1);
+    link->line_length = 0;
+    link->rx_bytes = 0;
+    link->rx_dropped = 0;
+    link->rx_overruns = 0;
+    return true;
+}
+
+static void esp32_cam_ai_link_start(ESP32CamAILink* link, uint32_t baudrate) {
+    furi_hal_serial_init(link->serial_handle, baudrate);
+    furi_hal_serial_dma_rx_start(link->serial_handle, esp32_cam_ai_uart_rx_callback, link, true);
+    link->receiving = true;
+}
+
+// Stop RX first so the ISR never touches a freed stream buffer
+static void esp32_cam_ai_link_stop(ESP32CamAILink* link) {
+    if(!link->receiving) return;
+    furi_hal_serial_dma_rx_stop(link->serial_handle);
+    link->receiving = false;
+}
+
+static void esp32_cam_ai_link_release(ESP32CamAILink* link) {
+    if(link->rx_stream) {
+        furi_stream_buffer_free(link->rx_stream);
+        link->rx_stream = NULL;
+    }
+    if(link->serial_handle) {
+        furi_hal_serial_deinit(link->serial_handle);
+        furi_hal_serial_control_release(link->serial_handle);
+        link->serial_handle = NULL;
+    }
+}
+
+bool esp32_cam_ai_uart_init(ESP32CamAI* app) {
+    FURI_LOG_I(TAG, "Initializing UART...");
+    
+    if(!esp32_cam_ai_link_acquire(&app->main_link)) {
+        FURI_LOG_E(TAG, "Failed to acquire serial handle");
+        return false;
+    }
+    
+    app->tx_queue = furi_message_queue_alloc(TX_QUEUE_SIZE, sizeof(ESP32CamAICommand));
+    app->cache_queue = furi_message_queue_alloc(CACHE_QUEUE_SIZE, sizeof(ESP32CamAICacheMessage));
+    app->flow_pauses = 0;
+    app->trace_session = app->trace_mode;
+    app->trace_bytes = 0;
+    app->trace_checked = 0;
+    app->trace_matched = 0;
+    app->trace_cut = false;
+    bool replay = esp32_cam_ai_trace_is_replay(app);
+    
+    // The ESP32-CAM boots at the default rate, faster ones are negotiated
+    app->baudrate = BAUDRATE;
+    
+    // The RX callback signals the worker, so it must exist before reception starts
+    app->worker_thread = furi_thread_alloc_ex("ESP32CamWorker", 2048, esp32_cam_ai_worker, app);
+    furi_thread_start(app->worker_thread);
+    
+    app->cache_thread = furi_thread_alloc_ex("ESP32CamCache", 2048, esp32_cam_ai_cache_worker, app);
+    furi_thread_start(app->cache_thread);
+    
+    // A replay stands in for the peer, so nothing is received from the real one
+    if(replay) {
+        furi_hal_serial_init(app->main_link.serial_handle, app->baudrate);
+        FURI_LOG_I(TAG, "Replaying UART trace, RX off");
+        return true;
+    }
+    esp32_cam_ai_link_start(&app->main_link, app->baudrate);
+    
+    // The second camera is optional, the app runs on without it
+    if(app->second_camera) {
+        if(esp32_cam_ai_link_acquire(&app->second_link)) {
+            ESP32CamAIRequest* second = &app->requests[REQUEST_SECOND_SLOT];
+            if(!second->text) {
+                second->text = malloc(app->request_arena_size);
+                esp32_cam_ai_arena_reset(app, second);
+            }
+            esp32_cam_ai_link_start(&app->second_link, BAUDRATE);
+            FURI_LOG_I(TAG, "Second camera on LPUART at %d baud", BAUDRATE);
+        } else {
+            FURI_LOG_W(TAG, "LPUART busy, second camera off");
+        }
+    }
+    
+    // The worker finishes the bring-up with the STATUS/READY handshake
+    FURI_LOG_I(TAG, "UART initialized at %lu baud", app->baudrate);
+    
+    return true;
+}
+
+void esp32_cam_ai_uart_deinit(ESP32CamAI* app) {
+    esp32_cam_ai_link_stop(&app->main_link);
+    esp32_cam_ai_link_stop(&app->second_link);
+    if(app->second_link.serial_handle) {
+        FURI_LOG_I(
+            TAG,
+            "Second camera RX: %lu bytes, %lu dropped, %lu overruns",
+            app->second_link.rx_bytes,
+            app->second_link.rx_dropped,
+            app->second_link.rx_overruns);
+    }
+    if(app->main_link.serial_handle) {
+        FURI_LOG_I(
+            TAG,
+            "RX stats: %lu bytes, %lu dropped, %lu overruns, %lu pauses, %lu.%lu cycles/byte",
+            app->main_link.rx_bytes,
+            app->main_link.rx_dropped,
+            app->main_link.rx_overruns,
+            app->flow_pauses,
+            esp32_cam_ai_parse_cost_x10(app) / 10,
+            esp32_cam_ai_parse_cost_x10(app) % 10);
+    }
+    
+    // The cache thread hands slots back to the worker, so it stops first.
+    // Loans the worker makes after that are simply never returned.
+    if(app->cache_thread) {
+        ESP32CamAICacheMessage message = {.op = ESP32CamAICacheOpStop};
+        furi_message_queue_put(app->cache_queue, &message, FuriWaitForever);
+        furi_thread_join(app->cache_thread);
+        furi_thread_free(app->cache_thread);
+        app->cache_thread = NULL;
+    }
+    
+    if(app->worker_thread) {
+        furi_thread_flags_set(furi_thread_get_id(app->worker_thread), ESP32CamAIWorkerEventStop);
+        furi_thread_join(app->worker_thread);
+        furi_thread_free(app->worker_thread);
+        app->worker_thread = NULL;
+        esp32_cam_ai_log_dump(app);
+        FURI_LOG_I(
+            TAG,
+            "Startup: link up at %lu ms, first command at %lu ms",
+            app->startup_ready_ms,
+            app->startup_command_ms);
+        
+        uint32_t rate_x10 = esp32_cam_ai_worker_wakeup_rate_x10(app, app->worker_wakeups);
+        uint32_t idle_x10 = esp32_cam_ai_worker_wakeup_rate_x10(app, app->worker_idle_wakeups);
+        FURI_LOG_I(
+            TAG,
+            "Worker wakeups: %lu (%lu.%lu/s), %lu idle (%lu.%lu/s)",
+            app->worker_wakeups,
+            rate_x10 / 10,
+            rate_x10 % 10,
+            app->worker_idle_wakeups,
+            idle_x10 / 10,
+            idle_x10 % 10);
+    }
+    
+    // With the worker gone this is the only writer, so waiting for room is safe
+    if(app->archive_thread) {
+        uint8_t header[ARCHIVE_RECORD_HEADER_SIZE] = {ESP32CamAIArchiveStop, 0, 0};
+        furi_stream_buffer_send(app->archive_stream, header, sizeof(header), FuriWaitForever);
+        furi_thread_join(app->archive_thread);
+        furi_thread_free(app->archive_thread);
+        app->archive_thread = NULL;
+    }
+    
+    if(app->archive_stream) {
+        furi_stream_buffer_free(app->archive_stream);
+        app->archive_stream = NULL;
+    }
+    
+    if(app->cache_queue) {
+        furi_message_queue_free(app->cache_queue);
+        app->cache_queue = NULL;
+    }
+    
+    if(app->tx_queue) {
+        furi_message_queue_free(app->tx_queue);
+        app->tx_queue = NULL;
+    }
+    
+    esp32_cam_ai_link_release(&app->main_link);
+    esp32_cam_ai_link_release(&app->second_link);
+}
+
+// Worker state of a new app, once the settings are in. The GUI and the
+// host benchmark under tests/ both start from here.
+void esp32_cam_ai_worker_alloc(ESP32CamAI* app) {
+    app->baudrate = BAUDRATE;
+    app->uart_connected = false;
+    app->handshake = ESP32CamAIHandshakeWaiting;
+    app->startup_ready_ms = 0;
+    app->startup_command_ms = 0;
+    app->ptt_active = false;
+    app->flash_status = false;
+    app->is_vision_mode = false;  // NUOVO
+    app->main_link.app = app;
+    app->main_link.serial_id = UART_CH;
+    app->main_link.serial_handle = NULL;
+    app->main_link.receiving = false;
+    app->main_link.rx_stream = NULL;
+    app->second_link.app = app;
+    app->second_link.serial_id = SECOND_UART_CH;
+    app->second_link.serial_handle = NULL;
+    app->second_link.receiving = false;
+    app->second_link.rx_stream = NULL;
+    app->second_link.rx_bytes = 0;
+    app->second_link.rx_dropped = 0;
+    app->second_link.rx_overruns = 0;
+    app->broadcast_active = false;
+    app->worker_thread = NULL;
+    app->ui_pending = false;
+    app->ui_change_tick = 0;
+    app->response_generation = 0;
+    app->tx_queue = NULL;
+    app->cache_thread = NULL;
+    app->cache_queue = NULL;
+    app->link_archive = false;
+    app->link_archive_refused = false;
+    app->archive_thread = NULL;
+    app->archive_stream = NULL;
+    app->archive_next = 0;
+    app->archive_jpeg_active = false;
+    app->archive_saved = 0;
+    app->archive_dropped = 0;
+    app->archive_rate = 0;
+    app->preview_active = false;
+    app->viewfinder_enabled = false;
+    app->viewfinder_running = false;
+    app->cache_index_dirty = false;
+    app->cache_hits = 0;
+    app->cache_misses = 0;
+    app->link_framed = false;
+    app->link_tagged = false;
+    app->link_compressed = false;
+    app->link_flow = false;
+    app->link_mode = 0;
+    app->link_flow_window = FLOW_WINDOW_DEFAULT;
+    app->flow_consumed = 0;
+    app->flow_credited = 0;
+    app->flow_pauses = 0;
+    app->link_step = ESP32CamAILinkStepNone;
+    app->baud_state = ESP32CamAIBaudIdle;
+    app->frames_ok = 0;
+    app->frames_bad = 0;
+    app->stream_text_rate = 0;
+    app->stream_wire_rate = 0;
+    app->main_link.rx_bytes = 0;
+    app->main_link.rx_dropped = 0;
+    app->main_link.rx_overruns = 0;
+    app->parse_cycles = 0;
+    app->parse_bytes = 0;
+    app->trace_session = ESP32CamAITraceOff;
+    app->trace_capturing = false;
+    app->trace_replaying = false;
+    app->trace_answer_count = 0;
+    app->trace_bytes = 0;
+    app->trace_checked = 0;
+    app->trace_matched = 0;
+    app->trace_cut = false;
+    
+    esp32_cam_ai_reply_index_build();
+    
+    // The arenas are sized for the answer cap selected now; a larger cap
+    // selected later applies from the next launch. furi's malloc never
+    // fails, it halts, so a heap too short for the selected cap gets a
+    // smaller one instead.
+    size_t arena_cap = app->response_cap;
+    size_t heap_block = memmgr_heap_get_max_free_block();
+    while(arena_cap > RESPONSE_CAP_MIN &&
+          REQUEST_SECOND_SLOT * (arena_cap + REQUEST_ARENA_EXTRA) + REQUEST_ARENA_HEADROOM > heap_block) {
+        arena_cap /= 2;
+    }
+    if(arena_cap < app->response_cap) {
+        FURI_LOG_W(TAG, "Answer cap %lu does not fit the heap, using %u", app->response_cap, arena_cap);
+    }
+    app->request_arena_size = arena_cap + REQUEST_ARENA_EXTRA;
+    app->request_arenas = malloc(REQUEST_SECOND_SLOT * app->request_arena_size);
+    esp32_cam_ai_response_cap_apply(app);
+    for(size_t i = 0; i < COUNT_OF(app->requests); i++) {
+        ESP32CamAIRequest* request = &app->requests[i];
+        request->id = 0;
+        request->pending = false;
+        request->deadline = 0;
+        request->arena_peak = 0;
+        if(i < REQUEST_SECOND_SLOT) {
+            request->text = app->request_arenas + i * app->request_arena_size;
+            esp32_cam_ai_arena_reset(app, request);
+        } else {
+            request->text = NULL;
+            request->arena_top = app->request_arena_size;
+            request->text_size = 0;
+        }
+        request->generation = 0;
+        request->stream_id = 0;
+        request->stream_active = false;
+        request->stream_truncated = false;
+        request->stream_base = 0;
+        request->stream_start_tick = 0;
+        request->stream_wire_bytes = 0;
+        memset(&request->lz, 0, sizeof(request->lz));
+        request->stats_command = ESP32CamAIStatsCount;
+        request->stats_sent_tick = 0;
+        request->stats_first_tick = 0;
+        request->stats_final_tick = 0;
+        request->cache_line = NULL;
+        request->cache_loan = ESP32CamAICacheLoanNone;
+        request->archive_name[0] = '\0';
+    }
+    app->request = &app->requests[0];
+    app->request_focus = 0;
+    app->request_next_id = 1;
+    for(size_t i = 0; i < COUNT_OF(app->response_snapshots); i++) {
+        // Grows with the answers shown, never beyond the arena it copies from
+        app->response_snapshots[i].text = furi_string_alloc();
+        app->response_snapshots[i].generation = 0;
+        app->response_snapshots[i].change_tick = 0;
+        app->response_snapshots[i].stats_command = ESP32CamAIStatsCount;
+        app->response_snapshots[i].stats_final_tick = 0;
+    }
+    esp32_cam_ai_triple_init(&app->response_buffer);
+    app->main_link.line_length = 0;
+    memset(app->stats, 0, sizeof(app->stats));
+    app->stats_mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+}
+
+void esp32_cam_ai_worker_free(ESP32CamAI* app) {
+    free(app->request_arenas);
+    free(app->requests[REQUEST_SECOND_SLOT].text);
+    for(size_t i = 0; i < COUNT_OF(app->response_snapshots); i++) {
+        furi_string_free(app->response_snapshots[i].text);
+    }
+    furi_mutex_free(app->stats_mutex);
+}
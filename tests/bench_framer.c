@@ -0,0 +1,160 @@
+// Line framer microbenchmark: esp32_cam_ai_line_take on RX_CHUNK_SIZE blocks
+// against the per-byte loop the worker used before, which pushed every byte
+// onto a string and checked it for a line end on its own. Only the framing
+// is timed; the per-byte loop's stream buffer read for every byte is not
+// modeled, so on the device the gap is wider than shown here.
+
+#include "esp32_cam_ai_proto.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define RX_CHUNK_SIZE (256)
+#define STREAM_SIZE (1 << 20)
+#define RUNS (7)
+
+typedef struct {
+    const char* name;
+    size_t line_min;
+    size_t line_max;
+    bool crlf;
+} Workload;
+
+static const Workload workloads[] = {
+    {"replies", 8, 32, false},          // PROCESSING, OK:..., tagged status lines
+    {"replies crlf", 8, 32, true},
+    {"chunks", 200, 260, false},        // CHUNK:<id>:<text> of a streamed answer
+    {"overlong", 600, 900, false},      // Cut to LINE_BUFFER_SIZE
+};
+
+typedef struct {
+    uint32_t lines;
+    uint64_t length_sum;
+} Result;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void stream_make(uint8_t* stream, const Workload* workload) {
+    uint32_t state = 7;
+    size_t at = 0;
+    
+    while(at < STREAM_SIZE) {
+        state = state * 1103515245UL + 12345;
+        size_t length = workload->line_min + (state >> 16) % (workload->line_max - workload->line_min + 1);
+        for(size_t i = 0; i < length && at < STREAM_SIZE; i++) {
+            state = state * 1103515245UL + 12345;
+            stream[at++] = ' ' + (state >> 16) % 95;
+        }
+        if(workload->crlf && at < STREAM_SIZE) stream[at++] = '\r';
+        if(at < STREAM_SIZE) stream[at++] = '\n';
+    }
+}
+
+static void line_done(Result* result, const char* line, size_t length) {
+    result->lines++;
+    result->length_sum += length + (uint8_t)line[0];
+}
+
+// The string the old loop grew a byte at a time, as furi_string_push_back does
+typedef struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+} String;
+
+__attribute__((noinline)) static void string_push_back(String* string, char c) {
+    if(string->size + 1 >= string->capacity) {
+        string->capacity = string->capacity ? string->capacity * 2 : 16;
+        string->data = realloc(string->data, string->capacity);
+    }
+    string->data[string->size++] = c;
+    string->data[string->size] = '\0';
+}
+
+static void frame_per_byte(const uint8_t* stream, Result* result) {
+    static String line;
+    line.size = 0;
+    
+    for(size_t chunk = 0; chunk < STREAM_SIZE; chunk += RX_CHUNK_SIZE) {
+        for(size_t i = chunk; i < chunk + RX_CHUNK_SIZE; i++) {
+            uint8_t data = stream[i];
+            if(data == '\n' || data == '\r') {
+                if(line.size > 0) {
+                    line_done(result, line.data, line.size);
+                    line.size = 0;
+                }
+            } else if(line.size < LINE_BUFFER_SIZE) {
+                string_push_back(&line, data);
+            }
+        }
+    }
+}
+
+static void frame_line_take(const uint8_t* stream, Result* result) {
+    static char line[LINE_BUFFER_SIZE + 1];
+    size_t line_length = 0;
+    
+    for(size_t chunk = 0; chunk < STREAM_SIZE; chunk += RX_CHUNK_SIZE) {
+        const uint8_t* data = stream + chunk;
+        size_t size = RX_CHUNK_SIZE;
+        while(size > 0) {
+            bool complete;
+            size_t taken = esp32_cam_ai_line_take(line, &line_length, false, data, size, &complete);
+            data += taken;
+            size -= taken;
+            if(!complete) break;
+            if(line_length > 0) {
+                line_done(result, line, line_length);
+                line_length = 0;
+            }
+        }
+    }
+}
+
+static double best_ns_per_byte(void (*frame)(const uint8_t*, Result*), const uint8_t* stream, Result* result) {
+    uint64_t best = UINT64_MAX;
+    
+    for(int run = 0; run < RUNS; run++) {
+        memset(result, 0, sizeof(*result));
+        uint64_t start = now_ns();
+        frame(stream, result);
+        uint64_t elapsed = now_ns() - start;
+        if(elapsed < best) best = elapsed;
+    }
+    return (double)best / STREAM_SIZE;
+}
+
+int main(void) {
+    static uint8_t stream[STREAM_SIZE];
+    bool ok = true;
+    
+    printf("%-14s %12s %12s %8s %8s\n", "workload", "per-byte", "line_take", "speedup", "lines");
+    for(size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); w++) {
+        stream_make(stream, &workloads[w]);
+        Result old_result;
+        Result new_result;
+        double old_ns = best_ns_per_byte(frame_per_byte, stream, &old_result);
+        double new_ns = best_ns_per_byte(frame_line_take, stream, &new_result);
+        
+        printf(
+            "%-14s %8.3f ns/B %8.3f ns/B %7.1fx %8u\n",
+            workloads[w].name,
+            old_ns,
+            new_ns,
+            old_ns / new_ns,
+            new_result.lines);
+        
+        // Both must see the same lines
+        if(old_result.lines != new_result.lines || old_result.length_sum != new_result.length_sum) {
+            printf("%s: line mismatch, %u against %u\n", workloads[w].name, old_result.lines, new_result.lines);
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
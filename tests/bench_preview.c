@@ -0,0 +1,196 @@
+// Preview and answer decoding microbenchmark. Grayscale 128x64 frames go
+// through each dither mode in the runs image frames deliver them in, next to
+// a per-pixel float Floyd-Steinberg for reference; compressed answers go
+// through the LZ decoder. Reports ns and, on x86, TSC cycles per pixel and
+// per decoded byte. Host figures rank the modes; the device's own cycles per
+// pixel are on the preview screen's stats.
+
+#include "esp32_cam_ai_proto.h"
+#include "lz_encode.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC (1)
+#else
+#define HAVE_TSC (0)
+#endif
+
+#define WIDTH (128)
+#define HEIGHT (64)
+#define STRIDE (WIDTH / 8)
+#define RUN_SIZE (FRAME_PAYLOAD_MAX - 2)    // Pixels in one image frame
+#define FRAMES (200)
+#define RUNS (5)
+#define ANSWER_SIZE (6000)
+#define ANSWERS (200)
+
+typedef struct {
+    uint64_t ns;
+    uint64_t cycles;
+} Timing;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t now_cycles(void) {
+#if HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static void frame_make(uint8_t* gray) {
+    // A gradient with a bright blob, so every mode has to decide both ways
+    for(uint32_t y = 0; y < HEIGHT; y++) {
+        for(uint32_t x = 0; x < WIDTH; x++) {
+            int32_t dx = (int32_t)x - 80;
+            int32_t dy = (int32_t)y - 30;
+            int32_t value = x * 2 + (dx * dx + dy * dy < 400 ? 100 : 0);
+            gray[y * WIDTH + x] = value > 255 ? 255 : value;
+        }
+    }
+}
+
+// As the app's preview_decode: runs of a frame, split where rows end
+static void dither_frame(ESP32CamAIDitherMode mode, const uint8_t* gray, uint8_t* framebuffer) {
+    ESP32CamAIDither dither;
+    esp32_cam_ai_dither_begin(&dither, mode);
+    memset(framebuffer, 0, STRIDE * HEIGHT);
+    
+    for(uint32_t offset = 0; offset < WIDTH * HEIGHT; offset += RUN_SIZE) {
+        uint32_t size = WIDTH * HEIGHT - offset < RUN_SIZE ? WIDTH * HEIGHT - offset : RUN_SIZE;
+        const uint8_t* data = gray + offset;
+        uint32_t row = offset / WIDTH;
+        uint32_t column = offset % WIDTH;
+        for(uint32_t left = size; left > 0;) {
+            uint32_t run = left < WIDTH - column ? left : WIDTH - column;
+            esp32_cam_ai_dither_run(&dither, data, run, row, column, framebuffer + row * STRIDE, 0);
+            data += run;
+            left -= run;
+            column += run;
+            if(column == WIDTH) {
+                column = 0;
+                row++;
+            }
+        }
+    }
+}
+
+// The straightforward version: whole float error rows, one pixel at a time
+static void dither_float(const uint8_t* gray, uint8_t* framebuffer) {
+    static float error[HEIGHT + 1][WIDTH + 2];
+    memset(error, 0, sizeof(error));
+    memset(framebuffer, 0, STRIDE * HEIGHT);
+    
+    for(uint32_t y = 0; y < HEIGHT; y++) {
+        for(uint32_t x = 0; x < WIDTH; x++) {
+            float value = gray[y * WIDTH + x] + error[y][x + 1];
+            float quantized = value < 128.0f ? 0.0f : 255.0f;
+            float residual = value - quantized;
+            if(quantized == 0.0f) framebuffer[y * STRIDE + x / 8] |= 1 << (x & 7);
+            error[y][x + 2] += residual * 7.0f / 16.0f;
+            error[y + 1][x] += residual * 3.0f / 16.0f;
+            error[y + 1][x + 1] += residual * 5.0f / 16.0f;
+            error[y + 1][x + 2] += residual * 1.0f / 16.0f;
+        }
+    }
+}
+
+static uint32_t black_count(const uint8_t* framebuffer) {
+    uint32_t count = 0;
+    for(size_t i = 0; i < STRIDE * HEIGHT; i++) count += __builtin_popcount(framebuffer[i]);
+    return count;
+}
+
+static void report(const char* name, Timing best, uint32_t units, const char* unit, uint32_t black) {
+    printf("%-22s %8.2f ns/%s", name, (double)best.ns / units, unit);
+    if(HAVE_TSC) printf(" %8.2f cycles/%s", (double)best.cycles / units, unit);
+    if(black) printf("   %u of %u black", black, WIDTH * HEIGHT);
+    printf("\n");
+}
+
+int main(void) {
+    static uint8_t gray[WIDTH * HEIGHT];
+    static uint8_t framebuffer[STRIDE * HEIGHT];
+    static const char* const mode_names[ESP32CamAIDitherCount] = {"threshold", "bayer", "diffusion"};
+    volatile uint32_t sink = 0;
+    
+    frame_make(gray);
+    for(int mode = -1; mode < ESP32CamAIDitherCount; mode++) {
+        Timing best = {UINT64_MAX, UINT64_MAX};
+        for(int run = 0; run < RUNS; run++) {
+            uint64_t ns = now_ns();
+            uint64_t cycles = now_cycles();
+            for(int frame = 0; frame < FRAMES; frame++) {
+                if(mode < 0) {
+                    dither_float(gray, framebuffer);
+                } else {
+                    dither_frame(mode, gray, framebuffer);
+                }
+                sink += framebuffer[frame % (STRIDE * HEIGHT)];
+            }
+            cycles = now_cycles() - cycles;
+            ns = now_ns() - ns;
+            if(ns < best.ns) best.ns = ns;
+            if(cycles < best.cycles) best.cycles = cycles;
+        }
+        report(
+            mode < 0 ? "float floyd-steinberg" : mode_names[mode],
+            best,
+            FRAMES * WIDTH * HEIGHT,
+            "px",
+            black_count(framebuffer));
+    }
+    
+    // LZ: the answer arrives in frames, each decoded as it comes
+    static char answer[ANSWER_SIZE + 1];
+    static uint8_t compressed[ANSWER_SIZE * 2];
+    static char text[ANSWER_SIZE + 1];
+    const size_t chunk = FRAME_PAYLOAD_MAX - LZ_FRAME_HEADER_SIZE;
+    uint32_t state = 3;
+    for(size_t length = 0; length < ANSWER_SIZE;) {
+        // Words from a small vocabulary, as answers repeat themselves
+        static const char* const words[] = {"the ", "object ", "is ", "a ", "blue ", "cup ", "on ", "table. "};
+        state = state * 1103515245UL + 12345;
+        const char* word = words[(state >> 16) % 8];
+        size_t n = strlen(word) < ANSWER_SIZE - length ? strlen(word) : ANSWER_SIZE - length;
+        memcpy(answer + length, word, n);
+        length += n;
+    }
+    size_t compressed_size = lz_encode(answer, ANSWER_SIZE, compressed);
+    
+    Timing best = {UINT64_MAX, UINT64_MAX};
+    bool ok = true;
+    for(int run = 0; run < RUNS; run++) {
+        uint64_t ns = now_ns();
+        uint64_t cycles = now_cycles();
+        for(int n = 0; n < ANSWERS; n++) {
+            ESP32CamAILz lz = {0};
+            size_t text_size = 0;
+            for(size_t offset = 0; offset < compressed_size; offset += chunk) {
+                size_t size = compressed_size - offset < chunk ? compressed_size - offset : chunk;
+                esp32_cam_ai_lz_decode(&lz, compressed + offset, size, text, &text_size, 0, ANSWER_SIZE);
+            }
+            ok = ok && text_size == ANSWER_SIZE;
+        }
+        cycles = now_cycles() - cycles;
+        ns = now_ns() - ns;
+        if(ns < best.ns) best.ns = ns;
+        if(cycles < best.cycles) best.cycles = cycles;
+    }
+    ok = ok && memcmp(text, answer, ANSWER_SIZE) == 0;
+    report("lz decode", best, ANSWERS * ANSWER_SIZE, "B", 0);
+    printf("lz ratio %.2f, %zu of %u bytes\n", (double)compressed_size / ANSWER_SIZE, compressed_size, ANSWER_SIZE);
+    
+    if(!ok) printf("lz decode: text mismatch\n");
+    return ok ? 0 : 1;
+}
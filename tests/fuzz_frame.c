@@ -0,0 +1,179 @@
+// Fuzz harness for the framed receive path: the line framer, cobs_decode and
+// frame_decode, then the LZ decoder on whatever passes. Any input must decode
+// without touching memory outside it, and whatever decodes must encode to a
+// frame that decodes to it again.
+//
+// Built with clang -fsanitize=fuzzer and -DLIBFUZZER it is a libFuzzer
+// target; otherwise it has its own driver, which replays the corpus files
+// given on the command line and then mutations and random inputs:
+//
+//   fuzz_frame <corpus files...>
+
+#include "esp32_cam_ai_proto.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FUZZ_ASSERT(condition)                                                          \
+    do {                                                                                \
+        if(!(condition)) {                                                              \
+            fprintf(stderr, "%s:%d: assertion failed: %s\n", __FILE__, __LINE__, #condition); \
+            abort();                                                                    \
+        }                                                                               \
+    } while(0)
+
+// Decode one received line the way process_frame does
+static void fuzz_frame(const char* line, size_t size) {
+    // Exact-size copies, so the sanitizer sees any access past the input
+    uint8_t* data = malloc(size + 1);
+    memcpy(data, line, size + 1);
+    
+    uint8_t* cobs = malloc(size ? size : 1);
+    memcpy(cobs, line, size);
+    size_t decoded = esp32_cam_ai_cobs_decode(cobs, size);
+    FUZZ_ASSERT(decoded <= size);
+    free(cobs);
+    
+    size_t payload_length;
+    if(esp32_cam_ai_frame_decode(data, size, &payload_length)) {
+        FUZZ_ASSERT(payload_length <= size);
+        uint8_t* payload = data + FRAME_HEADER_SIZE;
+        payload[payload_length] = '\0';
+        
+        // Round trip. The encoding may differ: the decoder also takes a
+        // block of 254 bytes at the very end without the code byte after it.
+        if(payload_length <= FRAME_PAYLOAD_MAX) {
+            uint8_t raw[FRAME_RAW_MAX];
+            uint8_t out[FRAME_ENCODED_MAX];
+            size_t encoded = esp32_cam_ai_frame_encode(data[0], payload, payload_length, raw, out);
+            FUZZ_ASSERT(encoded > 0 && out[encoded - 1] == FRAME_DELIMITER);
+            FUZZ_ASSERT(memchr(out, FRAME_DELIMITER, encoded - 1) == NULL);
+            
+            size_t again;
+            FUZZ_ASSERT(esp32_cam_ai_frame_decode(out, encoded - 1, &again));
+            FUZZ_ASSERT(again == payload_length && out[0] == data[0]);
+            FUZZ_ASSERT(memcmp(out + FRAME_HEADER_SIZE, payload, payload_length) == 0);
+        }
+        
+        if(data[0] == ESP32CamAIFrameLz && payload_length >= LZ_FRAME_HEADER_SIZE) {
+            // A short text before the answer, as the "✅ " prefix is in the app
+            const size_t base = 4;
+            const size_t capacity = 64;
+            char* text = malloc(capacity + 1);
+            memcpy(text, "ok: ", base);
+            size_t text_size = base;
+            ESP32CamAILz lz = {0};
+            esp32_cam_ai_lz_decode(
+                &lz,
+                payload + LZ_FRAME_HEADER_SIZE,
+                payload_length - LZ_FRAME_HEADER_SIZE,
+                text,
+                &text_size,
+                base,
+                capacity);
+            FUZZ_ASSERT(text_size >= base && text_size <= capacity);
+            FUZZ_ASSERT(text[text_size] == '\0');
+            free(text);
+        }
+    }
+    free(data);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    char line[LINE_BUFFER_SIZE + 1];
+    size_t line_length = 0;
+    
+    while(size > 0) {
+        bool complete;
+        size_t taken = esp32_cam_ai_line_take(line, &line_length, true, data, size, &complete);
+        FUZZ_ASSERT(taken > 0 && taken <= size);
+        FUZZ_ASSERT(line_length <= LINE_BUFFER_SIZE);
+        data += taken;
+        size -= taken;
+        if(!complete) break;
+        
+        if(line_length > 0) fuzz_frame(line, line_length);
+        line_length = 0;
+    }
+    return 0;
+}
+
+#ifndef LIBFUZZER
+
+#define RANDOM_INPUTS (200000)
+#define MUTATIONS (20000)
+#define INPUT_MAX (2048)
+
+static uint32_t fuzz_state = 1;
+
+static uint32_t fuzz_random(void) {
+    fuzz_state ^= fuzz_state << 13;
+    fuzz_state ^= fuzz_state >> 17;
+    fuzz_state ^= fuzz_state << 5;
+    return fuzz_state;
+}
+
+// Bit flips, byte changes, cuts and delimiters in the wrong places
+static size_t fuzz_mutate(uint8_t* data, size_t size) {
+    int edits = 1 + fuzz_random() % 4;
+    while(edits-- > 0 && size > 0) {
+        size_t at = fuzz_random() % size;
+        switch(fuzz_random() % 5) {
+            case 0:
+                data[at] ^= 1 << (fuzz_random() % 8);
+                break;
+            case 1:
+                data[at] = fuzz_random();
+                break;
+            case 2:
+                data[at] = FRAME_DELIMITER;
+                break;
+            case 3:
+                size = at;
+                break;
+            default:
+                data[at] = 0x00;
+                break;
+        }
+    }
+    return size;
+}
+
+int main(int argc, char** argv) {
+    static uint8_t corpus[64][INPUT_MAX];
+    static size_t corpus_size[64];
+    int corpus_count = 0;
+    
+    for(int i = 1; i < argc && corpus_count < 64; i++) {
+        FILE* file = fopen(argv[i], "rb");
+        if(!file) {
+            fprintf(stderr, "%s: cannot open\n", argv[i]);
+            return 1;
+        }
+        corpus_size[corpus_count] = fread(corpus[corpus_count], 1, INPUT_MAX, file);
+        fclose(file);
+        LLVMFuzzerTestOneInput(corpus[corpus_count], corpus_size[corpus_count]);
+        corpus_count++;
+    }
+    
+    uint8_t input[INPUT_MAX];
+    for(int n = 0; corpus_count > 0 && n < MUTATIONS; n++) {
+        int pick = fuzz_random() % corpus_count;
+        memcpy(input, corpus[pick], corpus_size[pick]);
+        LLVMFuzzerTestOneInput(input, fuzz_mutate(input, corpus_size[pick]));
+    }
+    for(int n = 0; n < RANDOM_INPUTS; n++) {
+        size_t size = fuzz_random() % 64;
+        for(size_t i = 0; i < size; i++) {
+            // Mostly short COBS codes, so some blocks come out well-formed
+            input[i] = fuzz_random() % 4 ? (fuzz_random() % 8) ^ FRAME_DELIMITER : fuzz_random();
+        }
+        LLVMFuzzerTestOneInput(input, size);
+    }
+    
+    printf("%d corpus files, %d mutations, %d random inputs: ok\n", corpus_count, MUTATIONS, RANDOM_INPUTS);
+    return 0;
+}
+
+#endif
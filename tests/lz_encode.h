@@ -0,0 +1,59 @@
+#pragma once
+
+// LZ encoder for the host tests and benchmarks, standing in for the peer's.
+// Greedy longest match over the whole window: slow, but it runs once per answer.
+
+#include "esp32_cam_ai_proto.h"
+
+typedef struct {
+    uint8_t* out;
+    size_t size;
+    uint32_t bits;
+    uint8_t count;
+} BitWriter;
+
+static void bits_put(BitWriter* writer, uint32_t value, uint8_t count) {
+    while(count-- > 0) {
+        writer->bits = (writer->bits << 1) | ((value >> count) & 1);
+        if(++writer->count == 8) {
+            writer->out[writer->size++] = writer->bits;
+            writer->bits = 0;
+            writer->count = 0;
+        }
+    }
+}
+
+// Greedy LZSS in the format esp32_cam_ai_lz_decode reads. Pad bits are zero,
+// too few to ever make a match token.
+static size_t lz_encode(const char* text, size_t size, uint8_t* out) {
+    const size_t window = 1 << LZ_WINDOW_BITS;
+    const size_t longest = 1 << LZ_LENGTH_BITS;
+    BitWriter writer = {out, 0, 0, 0};
+    
+    for(size_t i = 0; i < size;) {
+        size_t best_length = 0;
+        size_t best_offset = 0;
+        for(size_t j = i > window ? i - window : 0; j < i; j++) {
+            size_t length = 0;
+            while(length < longest && i + length < size && text[j + length] == text[i + length]) {
+                length++;
+            }
+            if(length > best_length) {
+                best_length = length;
+                best_offset = i - j;
+            }
+        }
+        if(best_length >= 2) {
+            bits_put(&writer, 0, 1);
+            bits_put(&writer, best_offset - 1, LZ_WINDOW_BITS);
+            bits_put(&writer, best_length - 1, LZ_LENGTH_BITS);
+            i += best_length;
+        } else {
+            bits_put(&writer, 1, 1);
+            bits_put(&writer, (uint8_t)text[i], 8);
+            i++;
+        }
+    }
+    if(writer.count > 0) bits_put(&writer, 0, 8 - writer.count);
+    return writer.size;
+}
@@ -0,0 +1,576 @@
+// Scripted-peer benchmark of the UART worker. A forked peer plays an
+// ESP32-CAM over a pair of pipes: reply bursts, long CHUNK answers, line
+// noise, a slow trickle and a framed link with LZ-compressed answers. The
+// app side is the real worker of esp32_cam_ai_worker.c on the furi shim in
+// shim/: it brings the link up, negotiates, sends the commands, and the
+// answers are checked in the snapshots the GUI would draw. Reports
+// throughput, the worker's own parse cost and the request latency.
+//
+//   peer_bench [--quick]
+
+#include "esp32_cam_ai_i.h"
+#include "lz_encode.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ANSWER_SHORT (48)               // Answers that fit in one OK line
+#define ANSWER_MAX (6000)
+#define ANSWER_VARIANTS (8)
+#define LATENCY_MAX (50001)
+#define LZ_CHUNK (FRAME_PAYLOAD_MAX - LZ_FRAME_HEADER_SIZE)
+#define CHUNK_TEXT (200)                // Answer bytes per CHUNK line, before escaping
+#define PEER_OUT_SIZE (32768)
+#define STALL_MS (10000)                // No answer for this long fails the run
+
+typedef enum {
+    ScenarioBurst,                      // Short tagged replies back to back
+    ScenarioStream,                     // Long answers in CHUNK lines
+    ScenarioNoise,                      // Valid replies between runs of garbage
+    ScenarioSlow,                       // Few bytes per write, paced, untagged
+    ScenarioFramed,                     // COBS frames, answers LZ-compressed
+    ScenarioCount,
+} Scenario;
+
+static const char* const scenario_names[ScenarioCount] = {"burst", "stream", "noise", "slow", "framed"};
+
+typedef struct {
+    uint32_t requests;
+    uint32_t answer_size;
+} ScenarioSize;
+
+static const ScenarioSize scenario_full[ScenarioCount] = {
+    {50000, ANSWER_SHORT}, {400, ANSWER_MAX}, {20000, ANSWER_SHORT}, {400, ANSWER_SHORT}, {400, ANSWER_MAX}};
+static const ScenarioSize scenario_quick[ScenarioCount] = {
+    {2000, ANSWER_SHORT}, {20, ANSWER_MAX}, {1000, ANSWER_SHORT}, {20, ANSWER_SHORT}, {20, ANSWER_MAX}};
+
+// What the peer accepts of the app's capability offers
+typedef struct {
+    bool flow;
+    bool framed;
+    bool tags;
+    bool compress;
+} ScenarioLink;
+
+static const ScenarioLink scenario_links[ScenarioCount] = {
+    {true, false, true, false},
+    {true, false, true, false},
+    {false, false, true, false},
+    {false, false, false, false},
+    {true, true, true, true}};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Same answer on both sides of the fork: "<seed> " and printable text with
+// repeats LZ finds. Long answers also carry line breaks and backslashes.
+static void answer_make(char* text, uint32_t size, uint32_t seed, bool escapes) {
+    static const char* const words[] = {
+        "the", "camera", "sees", "a", "red", "mug", "on", "wooden", "desk", "next", "to",
+        "keyboard", "and", "two", "pens", "lighting", "is", "warm", "übersicht", "→", "\n", "C:\\cam"};
+    size_t count = COUNT_OF(words) - (escapes ? 0 : 2);
+    uint32_t state = seed * 2654435761UL + 1;
+    uint32_t length = snprintf(text, size + 1, "%" PRIu32 " ", seed);
+    
+    while(length < size) {
+        state = state * 1103515245UL + 12345;
+        const char* word = words[(state >> 16) % count];
+        size_t word_length = strlen(word);
+        if(length + word_length + 1 > size) break;
+        memcpy(text + length, word, word_length);
+        length += word_length;
+        text[length++] = ' ';
+    }
+    while(length < size) text[length++] = '.';
+    text[size] = '\0';
+}
+
+// Peer side
+
+typedef struct {
+    Scenario scenario;
+    ScenarioSize size;
+    ScenarioLink link;
+    int in_fd;
+    int out_fd;
+    
+    char line[LINE_BUFFER_SIZE + 1];
+    size_t line_length;
+    bool framed;                        // Both directions, from FRAMED:OK on
+    bool tagged;
+    
+    uint8_t out[PEER_OUT_SIZE];
+    size_t out_head;
+    size_t out_fill;
+    uint64_t appended;                  // Bytes ever put in `out`
+    uint64_t written;                   // Bytes ever written to the app
+    
+    bool flow;
+    uint32_t flow_window;
+    uint64_t flow_start;                // `appended` right after FLOW:OK
+    uint64_t flow_credit;               // Running total of the last CREDIT:
+    
+    uint32_t queue_tag[TX_QUEUE_SIZE * 2];
+    uint32_t queue_seed[TX_QUEUE_SIZE * 2];
+    uint32_t queue_head;
+    uint32_t queue_count;
+    uint32_t unknown;
+    uint32_t noise;
+    
+    char answers[ANSWER_VARIANTS][ANSWER_MAX + 1];
+    uint8_t compressed[ANSWER_VARIANTS][ANSWER_MAX * 2];
+    size_t compressed_size[ANSWER_VARIANTS];
+} Peer;
+
+static void peer_append(Peer* peer, const void* data, size_t size) {
+    if(peer->out_head > 0) {
+        memmove(peer->out, peer->out + peer->out_head, peer->out_fill - peer->out_head);
+        peer->out_fill -= peer->out_head;
+        peer->out_head = 0;
+    }
+    if(peer->out_fill + size > sizeof(peer->out)) exit(2);
+    memcpy(peer->out + peer->out_fill, data, size);
+    peer->out_fill += size;
+    peer->appended += size;
+}
+
+static void peer_frame(Peer* peer, ESP32CamAIFrameType type, const void* payload, size_t size) {
+    uint8_t raw[FRAME_RAW_MAX];
+    uint8_t out[FRAME_ENCODED_MAX];
+    size_t length = esp32_cam_ai_frame_encode(type, payload, size, raw, out);
+    peer_append(peer, out, length);
+}
+
+// One protocol line, tagged with `tag` unless that is 0
+static void peer_line(Peer* peer, uint32_t tag, const char* format, ...) {
+    char line[LINE_BUFFER_SIZE];
+    int length = tag ? snprintf(line, sizeof(line), "#%" PRIu32 ":", tag) : 0;
+    va_list args;
+    va_start(args, format);
+    length += vsnprintf(line + length, sizeof(line) - length, format, args);
+    va_end(args);
+    
+    if(peer->framed) {
+        peer_frame(peer, ESP32CamAIFrameText, line, length);
+    } else {
+        peer_append(peer, line, length);
+        peer_append(peer, "\n", 1);
+    }
+}
+
+// CHUNK lines escape line breaks and backslashes
+static void peer_escape(char* out, const char* text, size_t size) {
+    size_t length = 0;
+    for(size_t i = 0; i < size; i++) {
+        if(text[i] == '\n' || text[i] == '\\') {
+            out[length++] = '\\';
+            out[length++] = text[i] == '\n' ? 'n' : '\\';
+        } else {
+            out[length++] = text[i];
+        }
+    }
+    out[length] = '\0';
+}
+
+static void peer_answer(Peer* peer, uint32_t tag, uint32_t seed) {
+    const char* answer = peer->answers[seed];
+    uint32_t stream_id = peer->appended & 0x7FFFFFFF;
+    
+    if(peer->scenario == ScenarioFramed) {
+        const uint8_t* compressed = peer->compressed[seed];
+        size_t compressed_size = peer->compressed_size[seed];
+        uint8_t payload[FRAME_PAYLOAD_MAX];
+        for(size_t offset = 0; offset < compressed_size; offset += LZ_CHUNK) {
+            size_t n = MIN(compressed_size - offset, (size_t)LZ_CHUNK);
+            payload[0] = tag;
+            for(int b = 0; b < 4; b++) {
+                payload[1 + b] = stream_id >> (8 * b);
+                payload[5 + b] = offset >> (8 * b);
+            }
+            memcpy(payload + LZ_FRAME_HEADER_SIZE, compressed + offset, n);
+            peer_frame(peer, ESP32CamAIFrameLz, payload, LZ_FRAME_HEADER_SIZE + n);
+        }
+        peer_line(peer, tag, "END:%" PRIu32, stream_id);
+    } else if(peer->scenario == ScenarioStream) {
+        char escaped[CHUNK_TEXT * 2 + 1];
+        peer_line(peer, tag, "PROCESSING");
+        for(size_t offset = 0; offset < peer->size.answer_size; offset += CHUNK_TEXT) {
+            size_t n = MIN(peer->size.answer_size - offset, (size_t)CHUNK_TEXT);
+            peer_escape(escaped, answer + offset, n);
+            peer_line(peer, tag, "CHUNK:%" PRIu32 ":%s", stream_id, escaped);
+        }
+        peer_line(peer, tag, "END:%" PRIu32, stream_id);
+    } else {
+        if(peer->scenario == ScenarioNoise) {
+            // Garbage, line ends included, then a clean line end. No '#', which
+            // could pass for a tag.
+            uint8_t garbage[48];
+            for(size_t b = 0; b < sizeof(garbage); b++) {
+                peer->noise = peer->noise * 1103515245UL + 12345;
+                garbage[b] = peer->noise >> 16;
+                if(garbage[b] == '#') garbage[b] = '~';
+            }
+            peer_append(peer, garbage, sizeof(garbage));
+            peer_append(peer, "\r\n", 2);
+        }
+        peer_line(peer, tag, "PROCESSING");
+        peer_line(peer, tag, "OK:%s", answer);
+    }
+}
+
+// Answer a capability offer as firmware with or without it would
+static void peer_offer(Peer* peer, bool accepted, const char* token) {
+    if(accepted) {
+        peer_line(peer, 0, "%s:OK", token);
+    } else {
+        peer_line(peer, 0, "ERROR:Unknown command");
+    }
+}
+
+static void peer_command(Peer* peer, const char* line) {
+    bool tagged;
+    uint32_t tag;
+    line = esp32_cam_ai_line_untag(line, &tagged, &tag);
+    
+    if(strcmp(line, "STATUS") == 0) {
+        peer_line(peer, 0, "STATUS:ready");
+    } else if(strncmp(line, "FLOW:", 5) == 0) {
+        // Counting starts right after the FLOW:OK line
+        peer_offer(peer, peer->link.flow, "FLOW");
+        if(peer->link.flow) {
+            peer->flow = true;
+            peer->flow_window = strtoul(line + 5, NULL, 10);
+            peer->flow_start = peer->appended;
+            peer->flow_credit = 0;
+        }
+    } else if(strcmp(line, "FRAMED") == 0) {
+        peer_offer(peer, peer->link.framed, "FRAMED");
+        peer->framed = peer->link.framed;
+    } else if(strcmp(line, "TAGS") == 0) {
+        peer_offer(peer, peer->link.tags, "TAGS");
+        peer->tagged = peer->link.tags;
+    } else if(strncmp(line, "COMPRESS:", 9) == 0) {
+        peer_offer(peer, peer->link.compress, "COMPRESS");
+    } else if(strncmp(line, "CREDIT:", 7) == 0) {
+        peer->flow_credit = strtoull(line + 7, NULL, 10);
+    } else if(strcmp(line, "LINK:RESET") == 0) {
+        peer->flow = false;
+        peer->framed = false;
+    } else if(strncmp(line, "CUSTOM_VISION:q", 15) == 0 && tagged == peer->tagged &&
+              peer->queue_count < COUNT_OF(peer->queue_tag)) {
+        size_t i = (peer->queue_head + peer->queue_count++) % COUNT_OF(peer->queue_tag);
+        peer->queue_tag[i] = tagged ? tag : 0;
+        peer->queue_seed[i] = strtoul(line + 15, NULL, 10) % ANSWER_VARIANTS;
+    } else {
+        peer->unknown++;
+        peer_line(peer, tagged ? tag : 0, "ERROR:Unknown command");
+    }
+}
+
+static void peer_receive(Peer* peer, const uint8_t* data, size_t size) {
+    while(size > 0) {
+        bool framed = peer->framed;
+        bool complete;
+        size_t taken =
+            esp32_cam_ai_line_take(peer->line, &peer->line_length, framed, data, size, &complete);
+        data += taken;
+        size -= taken;
+        if(!complete) break;
+        
+        size_t payload_length;
+        if(!framed) {
+            peer_command(peer, peer->line);
+        } else if(
+            peer->line_length > 0 &&
+            esp32_cam_ai_frame_decode((uint8_t*)peer->line, peer->line_length, &payload_length) &&
+            peer->line[0] == ESP32CamAIFrameText) {
+            peer->line[FRAME_HEADER_SIZE + payload_length] = '\0';
+            peer_command(peer, peer->line + FRAME_HEADER_SIZE);
+        } else if(peer->line_length > 0) {
+            peer->unknown++;
+        }
+        peer->line_length = 0;
+    }
+}
+
+// Bytes that may go out now: what the flow window leaves after FLOW:OK, and
+// 7 at a time for the slow peer, as a slow UART would deliver them
+static size_t peer_room(Peer* peer) {
+    size_t room = peer->out_fill - peer->out_head;
+    if(peer->flow) {
+        uint64_t free_until = peer->flow_start > peer->written ? peer->flow_start - peer->written : 0;
+        uint64_t after = peer->written > peer->flow_start ? peer->written - peer->flow_start : 0;
+        uint64_t in_flight = after - MIN(after, peer->flow_credit);
+        uint64_t allowed =
+            free_until + (in_flight < peer->flow_window ? peer->flow_window - in_flight : 0);
+        room = MIN(room, allowed);
+    }
+    if(peer->scenario == ScenarioSlow) room = MIN(room, (size_t)7);
+    return room;
+}
+
+// Answer commands in the order they came until the app closes its end
+static int peer_run(Peer* peer) {
+    uint8_t data[1024];
+    
+    fcntl(peer->out_fd, F_SETFL, O_NONBLOCK);
+    for(;;) {
+        if(peer->out_head == peer->out_fill && peer->queue_count > 0) {
+            size_t i = peer->queue_head;
+            peer->queue_head = (peer->queue_head + 1) % COUNT_OF(peer->queue_tag);
+            peer->queue_count--;
+            peer_answer(peer, peer->queue_tag[i], peer->queue_seed[i]);
+        }
+        
+        size_t room = peer_room(peer);
+        struct pollfd fds[2] = {
+            {.fd = peer->in_fd, .events = POLLIN},
+            {.fd = peer->out_fd, .events = room ? POLLOUT : 0},
+        };
+        if(poll(fds, 2, -1) < 0) {
+            if(errno == EINTR) continue;
+            return 1;
+        }
+        
+        if(fds[0].revents & (POLLIN | POLLHUP)) {
+            ssize_t n = read(peer->in_fd, data, sizeof(data));
+            if(n <= 0) break;
+            peer_receive(peer, data, n);
+        }
+        if(room && (fds[1].revents & POLLOUT)) {
+            ssize_t n = write(peer->out_fd, peer->out + peer->out_head, room);
+            if(n < 0 && errno != EAGAIN) break;
+            if(n > 0) {
+                peer->out_head += n;
+                peer->written += n;
+            }
+            if(peer->scenario == ScenarioSlow) usleep(20);
+        }
+    }
+    return peer->unknown ? 1 : 0;
+}
+
+// App side: the worker thread runs as in the app, this thread stands in
+// for the GUI
+
+typedef struct {
+    uint32_t ui_events;
+    uint32_t generation;
+    uint32_t checked;
+    uint32_t bad;
+    uint32_t latency_count;
+    uint32_t latency_us[LATENCY_MAX];
+    char answers[ANSWER_VARIANTS][ANSWER_MAX + 1];
+} Host;
+
+static bool host_custom_event(void* context, uint32_t event) {
+    Host* host = context;
+    UNUSED(event);
+    __atomic_add_fetch(&host->ui_events, 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+// Answers that finished, as the worker's statistics count them
+static uint32_t host_completions(ESP32CamAI* app) {
+    furi_mutex_acquire(app->stats_mutex, FuriWaitForever);
+    uint32_t count = app->stats[ESP32CamAIStatsCustomVision][ESP32CamAIStatsTransfer].count;
+    furi_mutex_release(app->stats_mutex);
+    return count;
+}
+
+// Take the latest response snapshot as the response view would and check a
+// finished answer in it against the one the peer was scripted to send
+static void host_check(Host* host, ESP32CamAI* app) {
+    const ESP32CamAIResponseSnapshot* snapshot = esp32_cam_ai_response_acquire(app);
+    if(!snapshot->stats_final_tick || snapshot->generation == host->generation) return;
+    host->generation = snapshot->generation;
+    
+    const char* text = furi_string_get_cstr(snapshot->text);
+    const char* prefix = "✅ ";
+    if(strncmp(text, prefix, strlen(prefix)) != 0) {
+        host->bad++;
+        return;
+    }
+    text += strlen(prefix);
+    uint32_t seed = strtoul(text, NULL, 10);
+    if(seed >= ANSWER_VARIANTS || strcmp(text, host->answers[seed]) != 0) {
+        host->bad++;
+        return;
+    }
+    host->checked++;
+}
+
+static void host_send(ESP32CamAI* app, uint32_t request) {
+    char question[16];
+    snprintf(question, sizeof(question), "q%" PRIu32, request);
+    esp32_cam_ai_uart_send_custom_command(app, "CUSTOM_VISION:", question);
+}
+
+static int compare_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+static bool scenario_run(Scenario scenario, ScenarioSize size, Host* host) {
+    static Peer peer;
+    int to_peer[2];
+    int to_app[2];
+    if(pipe(to_peer) != 0 || pipe(to_app) != 0) return false;
+    
+    memset(&peer, 0, sizeof(peer));
+    peer.scenario = scenario;
+    peer.size = size;
+    peer.link = scenario_links[scenario];
+    peer.noise = 12345;
+    bool escapes = size.answer_size > ANSWER_SHORT;
+    for(uint32_t i = 0; i < ANSWER_VARIANTS; i++) {
+        answer_make(peer.answers[i], size.answer_size, i, escapes);
+        if(scenario == ScenarioFramed) {
+            peer.compressed_size[i] = lz_encode(peer.answers[i], size.answer_size, peer.compressed[i]);
+        }
+    }
+    
+    fflush(stdout);
+    pid_t pid = fork();
+    if(pid == 0) {
+        close(to_peer[1]);
+        close(to_app[0]);
+        peer.in_fd = to_peer[0];
+        peer.out_fd = to_app[1];
+        _exit(peer_run(&peer));
+    }
+    close(to_peer[0]);
+    close(to_app[1]);
+    
+    memset(host, 0, offsetof(Host, answers));
+    memcpy(host->answers, peer.answers, sizeof(host->answers));
+    
+    // Settings as the GUI leaves them, with room for the long answers
+    static ESP32CamAI app;
+    memset(&app, 0, sizeof(app));
+    app.launch_tick = furi_get_tick();
+    app.baudrate_requested = BAUDRATE;
+    app.baudrate_verified = BAUDRATE;
+    app.response_cap = 8192;
+    app.flow_window = FLOW_WINDOW_DEFAULT;
+    app.preview_dither = ESP32CamAIDitherDiffusion;
+    app.archive_enabled = false;
+    app.trace_mode = ESP32CamAITraceOff;
+    app.second_camera = false;
+    app.view_dispatcher = view_dispatcher_alloc();
+    view_dispatcher_set_event_callback_context(app.view_dispatcher, host);
+    view_dispatcher_set_custom_event_callback(app.view_dispatcher, host_custom_event);
+    
+    esp32_cam_ai_worker_alloc(&app);
+    furi_shim_serial_attach(UART_CH, to_app[0], to_peer[1]);
+    bool ok = esp32_cam_ai_uart_init(&app);
+    
+    // The first request waits for the link to come up and is not timed
+    uint32_t total = size.requests + 1;
+    uint32_t outstanding = scenario_links[scenario].tags ? REQUEST_INFLIGHT_MAX : 1;
+    static uint64_t sent_ns[LATENCY_MAX];
+    uint32_t sent = 0;
+    uint32_t done = 0;
+    uint64_t start = now_ns();
+    uint64_t progress = start;
+    while(ok && done < total) {
+        uint32_t completions = host_completions(&app);
+        for(; done < completions && done < total; done++) {
+            if(done > 0 && host->latency_count < LATENCY_MAX) {
+                host->latency_us[host->latency_count++] = (now_ns() - sent_ns[done]) / 1000;
+            }
+            progress = now_ns();
+        }
+        while(sent < total && sent - done < (done ? outstanding : 1)) {
+            sent_ns[sent] = now_ns();
+            host_send(&app, sent++);
+        }
+        host_check(host, &app);
+        if(now_ns() - progress > (uint64_t)STALL_MS * 1000000) {
+            printf("%s: stalled after %" PRIu32 " answers\n", scenario_names[scenario], done);
+            ok = false;
+        }
+        usleep(20);
+    }
+    uint64_t wall_ns = progress - start;
+    
+    // The last refresh is coalesced, let it through
+    usleep(2 * UI_REFRESH_INTERVAL_MS * 1000);
+    host_check(host, &app);
+    
+    // RX counters are the callback's own until reception stops
+    esp32_cam_ai_uart_deinit(&app);
+    furi_shim_serial_detach(UART_CH);
+    uint32_t rx_bytes = app.main_link.rx_bytes;
+    close(to_peer[1]);
+    close(to_app[0]);
+    int status;
+    waitpid(pid, &status, 0);
+    
+    qsort(host->latency_us, host->latency_count, sizeof(uint32_t), compare_u32);
+    uint32_t p50 = host->latency_count ? host->latency_us[host->latency_count / 2] : 0;
+    uint32_t p99 = host->latency_count ? host->latency_us[host->latency_count * 99 / 100] : 0;
+    uint32_t cost_x10 = esp32_cam_ai_parse_cost_x10(&app);
+    const ESP32CamAIHistogram* transfer = &app.stats[ESP32CamAIStatsCustomVision][ESP32CamAIStatsTransfer];
+    
+    printf(
+        "%-7s %9" PRIu32 " B %8.2f MB/s %4" PRIu32 ".%" PRIu32 " ns/B  frames %5" PRIu32 "/%" PRIu32
+        " bad  pauses %4" PRIu32 "  dropped %" PRIu32 "  latency us p50 %6" PRIu32 " p99 %6" PRIu32
+        "  transfer ms p95 %" PRIu32 "  checked %" PRIu32 " (%" PRIu32 " redraws)\n",
+        scenario_names[scenario],
+        rx_bytes,
+        wall_ns ? rx_bytes * 1000.0 / wall_ns : 0.0,
+        cost_x10 / 10,
+        cost_x10 % 10,
+        app.frames_ok,
+        app.frames_bad,
+        app.flow_pauses,
+        app.main_link.rx_dropped,
+        p50,
+        p99,
+        esp32_cam_ai_stats_percentile(transfer, 95),
+        host->checked,
+        host->ui_events);
+    
+    // Without flow control nothing holds the peer back, so only a flow
+    // controlled link has to get by without dropping
+    bool dropped = scenario_links[scenario].flow && app.main_link.rx_dropped > 0;
+    ok = ok && WIFEXITED(status) && WEXITSTATUS(status) == 0 && done == total && host->bad == 0 &&
+         host->checked > 0 && app.frames_bad == 0 && !dropped;
+    if(!ok) {
+        printf(
+            "%s: FAILED, %" PRIu32 " of %" PRIu32 " answers, %" PRIu32 " wrong, peer status %d\n",
+            scenario_names[scenario],
+            done,
+            total,
+            host->bad,
+            status);
+    }
+    
+    esp32_cam_ai_worker_free(&app);
+    view_dispatcher_free(app.view_dispatcher);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    bool quick = argc > 1 && strcmp(argv[1], "--quick") == 0;
+    const ScenarioSize* sizes = quick ? scenario_quick : scenario_full;
+    static Host host;
+    bool ok = true;
+    
+    signal(SIGPIPE, SIG_IGN);
+    for(Scenario scenario = 0; scenario < ScenarioCount; scenario++) {
+        ok = scenario_run(scenario, sizes[scenario], &host) && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+// Host stand-in for the parts of furi the UART worker uses, on pthreads.
+// Only what esp32_cam_ai_worker.c needs is here; see furi_shim.c.
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UNUSED(x) (void)(x)
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define COUNT_OF(x) (sizeof(x) / sizeof(x[0]))
+
+#define furi_check(x) ((x) ? (void)0 : furi_shim_crash(#x, __FILE__, __LINE__))
+#define furi_assert(x) furi_check(x)
+void furi_shim_crash(const char* expression, const char* file, int line);
+
+// Logs below furi_shim_log_level are dropped: 1 errors, 2 warnings, 3 info
+extern int furi_shim_log_level;
+void furi_shim_log(int level, const char* tag, const char* format, ...);
+#define FURI_LOG_E(tag, ...) furi_shim_log(1, tag, __VA_ARGS__)
+#define FURI_LOG_W(tag, ...) furi_shim_log(2, tag, __VA_ARGS__)
+#define FURI_LOG_I(tag, ...) furi_shim_log(3, tag, __VA_ARGS__)
+#define FURI_LOG_D(tag, ...) furi_shim_log(4, tag, __VA_ARGS__)
+
+#define FuriWaitForever (0xFFFFFFFFU)
+
+typedef enum {
+    FuriStatusOk = 0,
+    FuriStatusErrorTimeout = -2,
+    FuriStatusErrorResource = -3,
+} FuriStatus;
+
+typedef enum {
+    FuriFlagWaitAny = 0x00000000U,
+    FuriFlagWaitAll = 0x00000001U,
+    FuriFlagNoClear = 0x00000002U,
+    FuriFlagError = 0x80000000U,
+    FuriFlagErrorTimeout = 0xFFFFFFFEU,
+} FuriFlag;
+
+// Kernel: one tick per millisecond
+uint32_t furi_get_tick(void);
+uint32_t furi_ms_to_ticks(uint32_t milliseconds);
+uint32_t furi_kernel_get_tick_frequency(void);
+void furi_delay_ms(uint32_t milliseconds);
+
+// Threads and their flags
+typedef struct FuriThread FuriThread;
+typedef FuriThread* FuriThreadId;
+typedef int32_t (*FuriThreadCallback)(void* context);
+
+FuriThread* furi_thread_alloc_ex(
+    const char* name,
+    uint32_t stack_size,
+    FuriThreadCallback callback,
+    void* context);
+void furi_thread_free(FuriThread* thread);
+void furi_thread_start(FuriThread* thread);
+bool furi_thread_join(FuriThread* thread);
+FuriThreadId furi_thread_get_id(FuriThread* thread);
+uint32_t furi_thread_flags_set(FuriThreadId thread_id, uint32_t flags);
+uint32_t furi_thread_flags_get(void);
+uint32_t furi_thread_flags_wait(uint32_t flags, uint32_t options, uint32_t timeout);
+
+typedef enum {
+    FuriMutexTypeNormal,
+    FuriMutexTypeRecursive,
+} FuriMutexType;
+
+typedef struct FuriMutex FuriMutex;
+FuriMutex* furi_mutex_alloc(FuriMutexType type);
+void furi_mutex_free(FuriMutex* mutex);
+FuriStatus furi_mutex_acquire(FuriMutex* mutex, uint32_t timeout);
+FuriStatus furi_mutex_release(FuriMutex* mutex);
+
+typedef struct FuriMessageQueue FuriMessageQueue;
+FuriMessageQueue* furi_message_queue_alloc(uint32_t msg_count, uint32_t msg_size);
+void furi_message_queue_free(FuriMessageQueue* queue);
+FuriStatus furi_message_queue_put(FuriMessageQueue* queue, const void* message, uint32_t timeout);
+FuriStatus furi_message_queue_get(FuriMessageQueue* queue, void* message, uint32_t timeout);
+
+typedef struct FuriStreamBuffer FuriStreamBuffer;
+FuriStreamBuffer* furi_stream_buffer_alloc(size_t size, size_t trigger_level);
+void furi_stream_buffer_free(FuriStreamBuffer* stream_buffer);
+size_t furi_stream_buffer_send(
+    FuriStreamBuffer* stream_buffer,
+    const void* data,
+    size_t length,
+    uint32_t timeout);
+size_t furi_stream_buffer_receive(
+    FuriStreamBuffer* stream_buffer,
+    void* data,
+    size_t length,
+    uint32_t timeout);
+size_t furi_stream_buffer_spaces_available(FuriStreamBuffer* stream_buffer);
+
+typedef struct FuriString FuriString;
+FuriString* furi_string_alloc(void);
+void furi_string_free(FuriString* string);
+size_t furi_string_size(const FuriString* string);
+const char* furi_string_get_cstr(const FuriString* string);
+void furi_string_set_str(FuriString* string, const char* text);
+void furi_string_set_strn(FuriString* string, const char* text, size_t length);
+void furi_string_cat_str(FuriString* string, const char* text);
+void furi_string_push_back(FuriString* string, char c);
+int furi_string_printf(FuriString* string, const char* format, ...);
+int furi_string_cat_printf(FuriString* string, const char* format, ...);
+#define furi_string_set(string, text) furi_string_set_str(string, text)
+
+// Heap: the host's is as good as unlimited
+size_t memmgr_heap_get_max_free_block(void);
+
+// Records: none exist on the host, furi_record_open gives NULL
+void* furi_record_open(const char* name);
+void furi_record_close(const char* name);
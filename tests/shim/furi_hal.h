@@ -0,0 +1,68 @@
+#pragma once
+
+// Host stand-in for the serial HAL: a UART is a pair of file descriptors
+// given to furi_shim_serial_attach, and DMA RX is a thread reading one.
+
+#include <furi.h>
+
+typedef enum {
+    FuriHalSerialIdUsart,
+    FuriHalSerialIdLpuart,
+    FuriHalSerialIdMax,
+} FuriHalSerialId;
+
+typedef enum {
+    FuriHalSerialRxEventData = (1 << 0),
+    FuriHalSerialRxEventIdle = (1 << 1),
+    FuriHalSerialRxEventFrameError = (1 << 2),
+    FuriHalSerialRxEventNoiseError = (1 << 3),
+    FuriHalSerialRxEventOverrunError = (1 << 4),
+} FuriHalSerialRxEvent;
+
+typedef struct FuriHalSerialHandle FuriHalSerialHandle;
+typedef void (*FuriHalSerialDmaRxCallback)(
+    FuriHalSerialHandle* handle,
+    FuriHalSerialRxEvent event,
+    size_t data_len,
+    void* context);
+
+// Make `id` available to furi_hal_serial_control_acquire: bytes read from
+// rx_fd arrive through DMA RX, furi_hal_serial_tx writes to tx_fd
+void furi_shim_serial_attach(FuriHalSerialId id, int rx_fd, int tx_fd);
+void furi_shim_serial_detach(FuriHalSerialId id);
+
+FuriHalSerialHandle* furi_hal_serial_control_acquire(FuriHalSerialId serial_id);
+void furi_hal_serial_control_release(FuriHalSerialHandle* handle);
+void furi_hal_serial_init(FuriHalSerialHandle* handle, uint32_t baud);
+void furi_hal_serial_deinit(FuriHalSerialHandle* handle);
+void furi_hal_serial_set_br(FuriHalSerialHandle* handle, uint32_t baud);
+void furi_hal_serial_tx(FuriHalSerialHandle* handle, const uint8_t* buffer, size_t buffer_size);
+void furi_hal_serial_tx_wait_complete(FuriHalSerialHandle* handle);
+void furi_hal_serial_dma_rx_start(
+    FuriHalSerialHandle* handle,
+    FuriHalSerialDmaRxCallback callback,
+    void* context,
+    bool report_errors);
+void furi_hal_serial_dma_rx_stop(FuriHalSerialHandle* handle);
+size_t furi_hal_serial_dma_rx(FuriHalSerialHandle* handle, uint8_t* data, size_t len);
+
+// The cycle counter counts nanoseconds of the calling thread's clock
+typedef struct {
+    uint32_t CYCCNT;
+} DWT_Type;
+
+DWT_Type* furi_shim_dwt(void);
+#define DWT (furi_shim_dwt())
+uint32_t furi_hal_cortex_instructions_per_microsecond(void);
+
+typedef struct {
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t second;
+    uint8_t day;
+    uint8_t month;
+    uint16_t year;
+    uint8_t weekday;
+} DateTime;
+
+void furi_hal_rtc_get_datetime(DateTime* datetime);
@@ -0,0 +1,779 @@
+// Host implementation of the furi shim: threads, flags, queues and stream
+// buffers on pthreads, a UART on a pair of file descriptors. Blocking calls
+// honour their timeouts, so the worker sleeps and wakes as on the device.
+
+#define _GNU_SOURCE
+
+#include <furi.h>
+#include <furi_hal.h>
+#include <gui/view_dispatcher.h>
+#include <storage/storage.h>
+#include <toolbox/saved_struct.h>
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+int furi_shim_log_level = 2;
+
+void furi_shim_crash(const char* expression, const char* file, int line) {
+    fprintf(stderr, "%s:%d: furi_check failed: %s\n", file, line, expression);
+    abort();
+}
+
+void furi_shim_log(int level, const char* tag, const char* format, ...) {
+    if(level > furi_shim_log_level) return;
+    
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "[%s] ", tag);
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+// Kernel
+
+static uint64_t shim_now_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+uint32_t furi_get_tick(void) {
+    return (uint32_t)(shim_now_ns(CLOCK_MONOTONIC) / 1000000);
+}
+
+uint32_t furi_ms_to_ticks(uint32_t milliseconds) {
+    return milliseconds;
+}
+
+uint32_t furi_kernel_get_tick_frequency(void) {
+    return 1000;
+}
+
+void furi_delay_ms(uint32_t milliseconds) {
+    usleep(milliseconds * 1000);
+}
+
+// Absolute deadline for pthread_cond_timedwait, NULL to wait forever
+static struct timespec* shim_deadline(struct timespec* ts, uint32_t timeout) {
+    if(timeout == FuriWaitForever) return NULL;
+    
+    clock_gettime(CLOCK_MONOTONIC, ts);
+    ts->tv_sec += timeout / 1000;
+    ts->tv_nsec += (long)(timeout % 1000) * 1000000;
+    if(ts->tv_nsec >= 1000000000) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
+    }
+    return ts;
+}
+
+// Wait on `cond` until `deadline`, false once it has passed
+static bool shim_wait(pthread_cond_t* cond, pthread_mutex_t* mutex, const struct timespec* deadline) {
+    if(!deadline) {
+        pthread_cond_wait(cond, mutex);
+        return true;
+    }
+    return pthread_cond_timedwait(cond, mutex, deadline) != ETIMEDOUT;
+}
+
+static void shim_cond_init(pthread_cond_t* cond) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+// Threads
+
+struct FuriThread {
+    pthread_t thread;
+    FuriThreadCallback callback;
+    void* context;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    uint32_t flags;
+};
+
+static __thread FuriThread* shim_current;
+
+FuriThread* furi_thread_alloc_ex(
+    const char* name,
+    uint32_t stack_size,
+    FuriThreadCallback callback,
+    void* context) {
+    UNUSED(name);
+    UNUSED(stack_size);
+    FuriThread* thread = calloc(1, sizeof(FuriThread));
+    thread->callback = callback;
+    thread->context = context;
+    pthread_mutex_init(&thread->lock, NULL);
+    shim_cond_init(&thread->changed);
+    return thread;
+}
+
+void furi_thread_free(FuriThread* thread) {
+    pthread_cond_destroy(&thread->changed);
+    pthread_mutex_destroy(&thread->lock);
+    free(thread);
+}
+
+static void* shim_thread_body(void* context) {
+    FuriThread* thread = context;
+    shim_current = thread;
+    thread->callback(thread->context);
+    return NULL;
+}
+
+void furi_thread_start(FuriThread* thread) {
+    furi_check(pthread_create(&thread->thread, NULL, shim_thread_body, thread) == 0);
+}
+
+bool furi_thread_join(FuriThread* thread) {
+    return pthread_join(thread->thread, NULL) == 0;
+}
+
+FuriThreadId furi_thread_get_id(FuriThread* thread) {
+    return thread;
+}
+
+uint32_t furi_thread_flags_set(FuriThreadId thread_id, uint32_t flags) {
+    pthread_mutex_lock(&thread_id->lock);
+    thread_id->flags |= flags;
+    uint32_t result = thread_id->flags;
+    pthread_cond_broadcast(&thread_id->changed);
+    pthread_mutex_unlock(&thread_id->lock);
+    return result;
+}
+
+uint32_t furi_thread_flags_get(void) {
+    FuriThread* thread = shim_current;
+    pthread_mutex_lock(&thread->lock);
+    uint32_t flags = thread->flags;
+    pthread_mutex_unlock(&thread->lock);
+    return flags;
+}
+
+uint32_t furi_thread_flags_wait(uint32_t flags, uint32_t options, uint32_t timeout) {
+    FuriThread* thread = shim_current;
+    struct timespec ts;
+    const struct timespec* deadline = shim_deadline(&ts, timeout);
+    uint32_t result = FuriFlagErrorTimeout;
+    
+    pthread_mutex_lock(&thread->lock);
+    for(;;) {
+        uint32_t set = thread->flags & flags;
+        bool done = (options & FuriFlagWaitAll) ? set == flags : set != 0;
+        if(done) {
+            result = set;
+            if(!(options & FuriFlagNoClear)) thread->flags &= ~set;
+            break;
+        }
+        if(timeout == 0 || !shim_wait(&thread->changed, &thread->lock, deadline)) break;
+    }
+    pthread_mutex_unlock(&thread->lock);
+    return result;
+}
+
+// Mutex
+
+struct FuriMutex {
+    pthread_mutex_t mutex;
+};
+
+FuriMutex* furi_mutex_alloc(FuriMutexType type) {
+    FuriMutex* mutex = malloc(sizeof(FuriMutex));
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    if(type == FuriMutexTypeRecursive) pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&mutex->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    return mutex;
+}
+
+void furi_mutex_free(FuriMutex* mutex) {
+    pthread_mutex_destroy(&mutex->mutex);
+    free(mutex);
+}
+
+FuriStatus furi_mutex_acquire(FuriMutex* mutex, uint32_t timeout) {
+    if(timeout == FuriWaitForever) {
+        pthread_mutex_lock(&mutex->mutex);
+        return FuriStatusOk;
+    }
+    return pthread_mutex_trylock(&mutex->mutex) == 0 ? FuriStatusOk : FuriStatusErrorTimeout;
+}
+
+FuriStatus furi_mutex_release(FuriMutex* mutex) {
+    pthread_mutex_unlock(&mutex->mutex);
+    return FuriStatusOk;
+}
+
+// Byte ring shared by the message queue and the stream buffer
+
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    size_t head;                        // Next byte to read
+    size_t fill;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} ShimRing;
+
+static void shim_ring_init(ShimRing* ring, size_t size) {
+    ring->data = malloc(size);
+    ring->size = size;
+    ring->head = 0;
+    ring->fill = 0;
+    pthread_mutex_init(&ring->lock, NULL);
+    shim_cond_init(&ring->changed);
+}
+
+static void shim_ring_deinit(ShimRing* ring) {
+    pthread_cond_destroy(&ring->changed);
+    pthread_mutex_destroy(&ring->lock);
+    free(ring->data);
+}
+
+static void shim_ring_write(ShimRing* ring, const uint8_t* data, size_t length) {
+    for(size_t i = 0; i < length; i++) {
+        ring->data[(ring->head + ring->fill + i) % ring->size] = data[i];
+    }
+    ring->fill += length;
+}
+
+static void shim_ring_read(ShimRing* ring, uint8_t* data, size_t length) {
+    for(size_t i = 0; i < length; i++) {
+        data[i] = ring->data[(ring->head + i) % ring->size];
+    }
+    ring->head = (ring->head + length) % ring->size;
+    ring->fill -= length;
+}
+
+// Message queue
+
+struct FuriMessageQueue {
+    ShimRing ring;
+    uint32_t msg_size;
+};
+
+FuriMessageQueue* furi_message_queue_alloc(uint32_t msg_count, uint32_t msg_size) {
+    FuriMessageQueue* queue = malloc(sizeof(FuriMessageQueue));
+    shim_ring_init(&queue->ring, (size_t)msg_count * msg_size);
+    queue->msg_size = msg_size;
+    return queue;
+}
+
+void furi_message_queue_free(FuriMessageQueue* queue) {
+    shim_ring_deinit(&queue->ring);
+    free(queue);
+}
+
+FuriStatus furi_message_queue_put(FuriMessageQueue* queue, const void* message, uint32_t timeout) {
+    ShimRing* ring = &queue->ring;
+    struct timespec ts;
+    const struct timespec* deadline = shim_deadline(&ts, timeout);
+    FuriStatus status = FuriStatusOk;
+    
+    pthread_mutex_lock(&ring->lock);
+    while(ring->size - ring->fill < queue->msg_size) {
+        if(timeout == 0 || !shim_wait(&ring->changed, &ring->lock, deadline)) {
+            status = timeout == 0 ? FuriStatusErrorResource : FuriStatusErrorTimeout;
+            break;
+        }
+    }
+    if(status == FuriStatusOk) {
+        shim_ring_write(ring, message, queue->msg_size);
+        pthread_cond_broadcast(&ring->changed);
+    }
+    pthread_mutex_unlock(&ring->lock);
+    return status;
+}
+
+FuriStatus furi_message_queue_get(FuriMessageQueue* queue, void* message, uint32_t timeout) {
+    ShimRing* ring = &queue->ring;
+    struct timespec ts;
+    const struct timespec* deadline = shim_deadline(&ts, timeout);
+    FuriStatus status = FuriStatusOk;
+    
+    pthread_mutex_lock(&ring->lock);
+    while(ring->fill < queue->msg_size) {
+        if(timeout == 0 || !shim_wait(&ring->changed, &ring->lock, deadline)) {
+            status = timeout == 0 ? FuriStatusErrorResource : FuriStatusErrorTimeout;
+            break;
+        }
+    }
+    if(status == FuriStatusOk) {
+        shim_ring_read(ring, message, queue->msg_size);
+        pthread_cond_broadcast(&ring->changed);
+    }
+    pthread_mutex_unlock(&ring->lock);
+    return status;
+}
+
+// Stream buffer. Like FreeRTOS's, send takes what fits and receive returns
+// whatever is there, waiting only while there is no room or nothing at all.
+
+struct FuriStreamBuffer {
+    ShimRing ring;
+};
+
+FuriStreamBuffer* furi_stream_buffer_alloc(size_t size, size_t trigger_level) {
+    UNUSED(trigger_level);
+    FuriStreamBuffer* stream_buffer = malloc(sizeof(FuriStreamBuffer));
+    shim_ring_init(&stream_buffer->ring, size);
+    return stream_buffer;
+}
+
+void furi_stream_buffer_free(FuriStreamBuffer* stream_buffer) {
+    shim_ring_deinit(&stream_buffer->ring);
+    free(stream_buffer);
+}
+
+size_t furi_stream_buffer_send(
+    FuriStreamBuffer* stream_buffer,
+    const void* data,
+    size_t length,
+    uint32_t timeout) {
+    ShimRing* ring = &stream_buffer->ring;
+    struct timespec ts;
+    const struct timespec* deadline = shim_deadline(&ts, timeout);
+    const uint8_t* bytes = data;
+    size_t sent = 0;
+    
+    pthread_mutex_lock(&ring->lock);
+    while(sent < length) {
+        size_t n = MIN(length - sent, ring->size - ring->fill);
+        if(n > 0) {
+            shim_ring_write(ring, bytes + sent, n);
+            sent += n;
+            pthread_cond_broadcast(&ring->changed);
+            continue;
+        }
+        if(timeout == 0 || !shim_wait(&ring->changed, &ring->lock, deadline)) break;
+    }
+    pthread_mutex_unlock(&ring->lock);
+    return sent;
+}
+
+size_t furi_stream_buffer_receive(
+    FuriStreamBuffer* stream_buffer,
+    void* data,
+    size_t length,
+    uint32_t timeout) {
+    ShimRing* ring = &stream_buffer->ring;
+    struct timespec ts;
+    const struct timespec* deadline = shim_deadline(&ts, timeout);
+    
+    pthread_mutex_lock(&ring->lock);
+    while(ring->fill == 0) {
+        if(timeout == 0 || !shim_wait(&ring->changed, &ring->lock, deadline)) break;
+    }
+    size_t n = MIN(length, ring->fill);
+    shim_ring_read(ring, data, n);
+    if(n > 0) pthread_cond_broadcast(&ring->changed);
+    pthread_mutex_unlock(&ring->lock);
+    return n;
+}
+
+size_t furi_stream_buffer_spaces_available(FuriStreamBuffer* stream_buffer) {
+    ShimRing* ring = &stream_buffer->ring;
+    pthread_mutex_lock(&ring->lock);
+    size_t spaces = ring->size - ring->fill;
+    pthread_mutex_unlock(&ring->lock);
+    return spaces;
+}
+
+// Strings
+
+struct FuriString {
+    char* text;
+    size_t size;
+    size_t capacity;
+};
+
+static void shim_string_reserve(FuriString* string, size_t size) {
+    if(size + 1 <= string->capacity) return;
+    string->capacity = MAX(size + 1, string->capacity * 2);
+    string->text = realloc(string->text, string->capacity);
+}
+
+FuriString* furi_string_alloc(void) {
+    FuriString* string = calloc(1, sizeof(FuriString));
+    shim_string_reserve(string, 16);
+    string->text[0] = '\0';
+    return string;
+}
+
+void furi_string_free(FuriString* string) {
+    free(string->text);
+    free(string);
+}
+
+size_t furi_string_size(const FuriString* string) {
+    return string->size;
+}
+
+const char* furi_string_get_cstr(const FuriString* string) {
+    return string->text;
+}
+
+void furi_string_set_strn(FuriString* string, const char* text, size_t length) {
+    shim_string_reserve(string, length);
+    memmove(string->text, text, length);
+    string->size = length;
+    string->text[length] = '\0';
+}
+
+void furi_string_set_str(FuriString* string, const char* text) {
+    furi_string_set_strn(string, text, strlen(text));
+}
+
+void furi_string_cat_str(FuriString* string, const char* text) {
+    size_t length = strlen(text);
+    shim_string_reserve(string, string->size + length);
+    memcpy(string->text + string->size, text, length + 1);
+    string->size += length;
+}
+
+void furi_string_push_back(FuriString* string, char c) {
+    char text[2] = {c, '\0'};
+    furi_string_cat_str(string, text);
+}
+
+static int shim_string_vcat(FuriString* string, const char* format, va_list args) {
+    va_list copy;
+    va_copy(copy, args);
+    int length = vsnprintf(NULL, 0, format, copy);
+    va_end(copy);
+    if(length < 0) return length;
+    
+    shim_string_reserve(string, string->size + length);
+    vsnprintf(string->text + string->size, length + 1, format, args);
+    string->size += length;
+    return length;
+}
+
+int furi_string_printf(FuriString* string, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    string->size = 0;
+    int length = shim_string_vcat(string, format, args);
+    va_end(args);
+    return length;
+}
+
+int furi_string_cat_printf(FuriString* string, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = shim_string_vcat(string, format, args);
+    va_end(args);
+    return length;
+}
+
+size_t memmgr_heap_get_max_free_block(void) {
+    return SIZE_MAX / 2;
+}
+
+void* furi_record_open(const char* name) {
+    UNUSED(name);
+    return NULL;
+}
+
+void furi_record_close(const char* name) {
+    UNUSED(name);
+}
+
+// Serial
+
+#define SHIM_SERIAL_CHUNK (128)
+
+struct FuriHalSerialHandle {
+    int rx_fd;
+    int tx_fd;
+    bool attached;
+    bool acquired;
+    FuriHalSerialDmaRxCallback callback;
+    void* context;
+    pthread_t rx_thread;
+    bool rx_running;
+    uint8_t rx_data[SHIM_SERIAL_CHUNK];     // Block the callback is taking
+    size_t rx_head;
+    size_t rx_fill;
+};
+
+static FuriHalSerialHandle shim_serial[FuriHalSerialIdMax];
+
+void furi_shim_serial_attach(FuriHalSerialId id, int rx_fd, int tx_fd) {
+    FuriHalSerialHandle* handle = &shim_serial[id];
+    memset(handle, 0, sizeof(*handle));
+    handle->rx_fd = rx_fd;
+    handle->tx_fd = tx_fd;
+    handle->attached = true;
+}
+
+void furi_shim_serial_detach(FuriHalSerialId id) {
+    shim_serial[id].attached = false;
+}
+
+FuriHalSerialHandle* furi_hal_serial_control_acquire(FuriHalSerialId serial_id) {
+    FuriHalSerialHandle* handle = &shim_serial[serial_id];
+    if(!handle->attached || handle->acquired) return NULL;
+    handle->acquired = true;
+    return handle;
+}
+
+void furi_hal_serial_control_release(FuriHalSerialHandle* handle) {
+    handle->acquired = false;
+}
+
+void furi_hal_serial_init(FuriHalSerialHandle* handle, uint32_t baud) {
+    UNUSED(handle);
+    UNUSED(baud);
+}
+
+void furi_hal_serial_deinit(FuriHalSerialHandle* handle) {
+    UNUSED(handle);
+}
+
+void furi_hal_serial_set_br(FuriHalSerialHandle* handle, uint32_t baud) {
+    UNUSED(handle);
+    UNUSED(baud);
+}
+
+// The peer may have gone; what it misses then no longer matters
+void furi_hal_serial_tx(FuriHalSerialHandle* handle, const uint8_t* buffer, size_t buffer_size) {
+    while(buffer_size > 0) {
+        ssize_t n = write(handle->tx_fd, buffer, buffer_size);
+        if(n <= 0) {
+            if(n < 0 && errno == EINTR) continue;
+            return;
+        }
+        buffer += n;
+        buffer_size -= n;
+    }
+}
+
+void furi_hal_serial_tx_wait_complete(FuriHalSerialHandle* handle) {
+    UNUSED(handle);
+}
+
+// Stands in for the DMA RX interrupt: every read from rx_fd is one idle-line
+// event, and the callback takes the bytes with furi_hal_serial_dma_rx
+static void* shim_serial_rx_body(void* context) {
+    FuriHalSerialHandle* handle = context;
+    
+    while(__atomic_load_n(&handle->rx_running, __ATOMIC_RELAXED)) {
+        struct pollfd pfd = {.fd = handle->rx_fd, .events = POLLIN};
+        if(poll(&pfd, 1, 10) <= 0) continue;
+        
+        ssize_t n = read(handle->rx_fd, handle->rx_data, sizeof(handle->rx_data));
+        if(n <= 0) break;
+        handle->rx_head = 0;
+        handle->rx_fill = n;
+        handle->callback(
+            handle, FuriHalSerialRxEventData | FuriHalSerialRxEventIdle, n, handle->context);
+    }
+    return NULL;
+}
+
+void furi_hal_serial_dma_rx_start(
+    FuriHalSerialHandle* handle,
+    FuriHalSerialDmaRxCallback callback,
+    void* context,
+    bool report_errors) {
+    UNUSED(report_errors);
+    handle->callback = callback;
+    handle->context = context;
+    handle->rx_running = true;
+    furi_check(pthread_create(&handle->rx_thread, NULL, shim_serial_rx_body, handle) == 0);
+}
+
+void furi_hal_serial_dma_rx_stop(FuriHalSerialHandle* handle) {
+    __atomic_store_n(&handle->rx_running, false, __ATOMIC_RELAXED);
+    pthread_join(handle->rx_thread, NULL);
+}
+
+size_t furi_hal_serial_dma_rx(FuriHalSerialHandle* handle, uint8_t* data, size_t len) {
+    size_t n = MIN(len, handle->rx_fill - handle->rx_head);
+    memcpy(data, handle->rx_data + handle->rx_head, n);
+    handle->rx_head += n;
+    return n;
+}
+
+DWT_Type* furi_shim_dwt(void) {
+    static __thread DWT_Type dwt;
+    dwt.CYCCNT = (uint32_t)shim_now_ns(CLOCK_THREAD_CPUTIME_ID);
+    return &dwt;
+}
+
+uint32_t furi_hal_cortex_instructions_per_microsecond(void) {
+    return 1000;
+}
+
+void furi_hal_rtc_get_datetime(DateTime* datetime) {
+    time_t now = time(NULL);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    datetime->hour = tm.tm_hour;
+    datetime->minute = tm.tm_min;
+    datetime->second = tm.tm_sec;
+    datetime->day = tm.tm_mday;
+    datetime->month = tm.tm_mon + 1;
+    datetime->year = tm.tm_year + 1900;
+    datetime->weekday = tm.tm_wday ? tm.tm_wday : 7;
+}
+
+// Views
+
+struct View {
+    void* model;
+    pthread_mutex_t lock;
+};
+
+View* view_alloc(void) {
+    View* view = calloc(1, sizeof(View));
+    pthread_mutex_init(&view->lock, NULL);
+    return view;
+}
+
+void view_free(View* view) {
+    pthread_mutex_destroy(&view->lock);
+    free(view->model);
+    free(view);
+}
+
+void view_allocate_model(View* view, ViewModelType type, size_t size) {
+    UNUSED(type);
+    view->model = calloc(1, size);
+}
+
+void* view_get_model(View* view) {
+    pthread_mutex_lock(&view->lock);
+    return view->model;
+}
+
+void view_commit_model(View* view, bool update) {
+    UNUSED(update);
+    pthread_mutex_unlock(&view->lock);
+}
+
+struct ViewDispatcher {
+    void* context;
+    ViewDispatcherCustomEventCallback custom_event_callback;
+};
+
+ViewDispatcher* view_dispatcher_alloc(void) {
+    return calloc(1, sizeof(ViewDispatcher));
+}
+
+void view_dispatcher_free(ViewDispatcher* view_dispatcher) {
+    free(view_dispatcher);
+}
+
+void view_dispatcher_set_event_callback_context(ViewDispatcher* view_dispatcher, void* context) {
+    view_dispatcher->context = context;
+}
+
+void view_dispatcher_set_custom_event_callback(
+    ViewDispatcher* view_dispatcher,
+    ViewDispatcherCustomEventCallback callback) {
+    view_dispatcher->custom_event_callback = callback;
+}
+
+void view_dispatcher_send_custom_event(ViewDispatcher* view_dispatcher, uint32_t event) {
+    if(view_dispatcher->custom_event_callback) {
+        view_dispatcher->custom_event_callback(view_dispatcher->context, event);
+    }
+}
+
+// Storage: no card
+
+File* storage_file_alloc(Storage* storage) {
+    UNUSED(storage);
+    return malloc(1);
+}
+
+void storage_file_free(File* file) {
+    free(file);
+}
+
+bool storage_file_open(File* file, const char* path, FS_AccessMode access_mode, FS_OpenMode open_mode) {
+    UNUSED(file);
+    UNUSED(path);
+    UNUSED(access_mode);
+    UNUSED(open_mode);
+    return false;
+}
+
+bool storage_file_close(File* file) {
+    UNUSED(file);
+    return false;
+}
+
+size_t storage_file_read(File* file, void* buff, size_t bytes_to_read) {
+    UNUSED(file);
+    UNUSED(buff);
+    UNUSED(bytes_to_read);
+    return 0;
+}
+
+size_t storage_file_write(File* file, const void* buff, size_t bytes_to_write) {
+    UNUSED(file);
+    UNUSED(buff);
+    UNUSED(bytes_to_write);
+    return 0;
+}
+
+bool storage_file_seek(File* file, uint32_t offset, bool from_start) {
+    UNUSED(file);
+    UNUSED(offset);
+    UNUSED(from_start);
+    return false;
+}
+
+uint64_t storage_file_size(File* file) {
+    UNUSED(file);
+    return 0;
+}
+
+bool storage_simply_mkdir(Storage* storage, const char* path) {
+    UNUSED(storage);
+    UNUSED(path);
+    return false;
+}
+
+bool storage_simply_remove(Storage* storage, const char* path) {
+    UNUSED(storage);
+    UNUSED(path);
+    return false;
+}
+
+bool storage_simply_remove_recursive(Storage* storage, const char* path) {
+    UNUSED(storage);
+    UNUSED(path);
+    return false;
+}
+
+bool saved_struct_load(const char* path, void* data, size_t size, uint8_t magic, uint8_t version) {
+    UNUSED(path);
+    UNUSED(data);
+    UNUSED(size);
+    UNUSED(magic);
+    UNUSED(version);
+    return false;
+}
+
+bool saved_struct_save(const char* path, const void* data, size_t size, uint8_t magic, uint8_t version) {
+    UNUSED(path);
+    UNUSED(data);
+    UNUSED(size);
+    UNUSED(magic);
+    UNUSED(version);
+    return false;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+// The worker never draws; these only give the app struct its types
+
+#include <gui/view.h>
+
+typedef struct Gui Gui;
@@ -0,0 +1,4 @@
+#pragma once
+
+typedef struct VariableItemList VariableItemList;
+typedef struct VariableItem VariableItem;
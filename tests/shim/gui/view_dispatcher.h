@@ -0,0 +1,16 @@
+#pragma once
+
+// Custom events go straight to the callback, on the thread that sends them
+
+#include <gui/view.h>
+
+typedef struct ViewDispatcher ViewDispatcher;
+typedef bool (*ViewDispatcherCustomEventCallback)(void* context, uint32_t event);
+
+ViewDispatcher* view_dispatcher_alloc(void);
+void view_dispatcher_free(ViewDispatcher* view_dispatcher);
+void view_dispatcher_set_event_callback_context(ViewDispatcher* view_dispatcher, void* context);
+void view_dispatcher_set_custom_event_callback(
+    ViewDispatcher* view_dispatcher,
+    ViewDispatcherCustomEventCallback callback);
+void view_dispatcher_send_custom_event(ViewDispatcher* view_dispatcher, uint32_t event);
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <furi.h>
+
+bool saved_struct_load(const char* path, void* data, size_t size, uint8_t magic, uint8_t version);
+bool saved_struct_save(const char* path, const void* data, size_t size, uint8_t magic, uint8_t version);
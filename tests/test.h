@@ -0,0 +1,18 @@
+#pragma once
+
+// Minimal checks for the host tests: failures are printed and counted, the
+// test's main returns TEST_RESULT() as its exit status.
+
+#include <stdio.h>
+
+static int test_failures;
+
+#define CHECK(condition)                                                         \
+    do {                                                                         \
+        if(!(condition)) {                                                       \
+            printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+            test_failures++;                                                     \
+        }                                                                        \
+    } while(0)
+
+#define TEST_RESULT() (printf("%s: %s\n", __FILE__, test_failures ? "FAILED" : "ok"), test_failures != 0)
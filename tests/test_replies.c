@@ -0,0 +1,151 @@
+// Reply table and tag parsing: every line goes to the handler of its leading
+// token and no other, whatever the answer text after it says.
+
+#include "esp32_cam_ai_proto.h"
+#include "test.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static size_t row_of(const char* token) {
+    for(size_t i = 0; i < esp32_cam_ai_reply_count; i++) {
+        if(strcmp(esp32_cam_ai_replies[i].token, token) == 0) return i;
+    }
+    return ESP32_CAM_AI_REPLY_NONE;
+}
+
+static void check_match(const char* line, const char* token, const char* arg) {
+    const char* got_arg;
+    size_t row = esp32_cam_ai_reply_match(line, &got_arg);
+    if(!token) {
+        CHECK(row == ESP32_CAM_AI_REPLY_NONE);
+        if(row != ESP32_CAM_AI_REPLY_NONE) printf("  \"%s\" matched %s\n", line, esp32_cam_ai_replies[row].token);
+        return;
+    }
+    CHECK(row == row_of(token));
+    CHECK(strcmp(got_arg, arg) == 0);
+    if(row != row_of(token) || strcmp(got_arg, arg) != 0) printf("  \"%s\"\n", line);
+}
+
+static void test_table(void) {
+    for(size_t i = 0; i < esp32_cam_ai_reply_count; i++) {
+        const ESP32CamAIReply* reply = &esp32_cam_ai_replies[i];
+        CHECK(reply->token_length == strlen(reply->token));
+        CHECK(esp32_cam_ai_reply_find(reply->token, reply->token_length) == i);
+    }
+    
+    CHECK(esp32_cam_ai_replies[row_of("OK")].final);
+    CHECK(esp32_cam_ai_replies[row_of("ERROR")].final);
+    CHECK(esp32_cam_ai_replies[row_of("END")].final);
+    CHECK(!esp32_cam_ai_replies[row_of("CHUNK")].final);
+    CHECK(!esp32_cam_ai_replies[row_of("READY")].final);
+    CHECK(!esp32_cam_ai_replies[row_of("PROCESSING")].final);
+}
+
+// Only the leading token counts
+static void test_answer_text(void) {
+    check_match("OK:the ERROR: was READY", "OK", "the ERROR: was READY");
+    check_match("ERROR:camera said OK:", "ERROR", "camera said OK:");
+    check_match("CHUNK:4:ERROR:late", "CHUNK", "4:ERROR:late");
+    check_match("STATUS:READY", "STATUS", "READY");
+    check_match("READY", "READY", "");
+    check_match("END:", "END", "");
+    check_match("OK::", "OK", ":");
+    check_match("Answer: OK", NULL, NULL);
+    check_match("the answer is ERROR:", NULL, NULL);
+}
+
+// Tokens are whole and exact: no prefixes, suffixes, case or padding
+static void test_near_misses(void) {
+    check_match("READYX", NULL, NULL);
+    check_match("ERRORS:x", NULL, NULL);
+    check_match("OKAY:x", NULL, NULL);
+    check_match("ok:x", NULL, NULL);
+    check_match("Ok", NULL, NULL);
+    check_match(" OK:x", NULL, NULL);
+    check_match("OK :x", NULL, NULL);
+    check_match("", NULL, NULL);
+    check_match(":OK", NULL, NULL);
+    check_match("O", NULL, NULL);
+    check_match("E", NULL, NULL);
+    
+    for(size_t i = 0; i < esp32_cam_ai_reply_count; i++) {
+        const ESP32CamAIReply* reply = &esp32_cam_ai_replies[i];
+        char shorter[32];
+        char line[40];
+        const char* arg;
+        
+        // One character short is never taken for the token
+        snprintf(shorter, sizeof(shorter), "%.*s", reply->token_length - 1, reply->token);
+        snprintf(line, sizeof(line), "%s:x", shorter);
+        CHECK(esp32_cam_ai_reply_match(line, &arg) == row_of(shorter));
+        
+        snprintf(line, sizeof(line), "%s_:x", reply->token);
+        CHECK(esp32_cam_ai_reply_match(line, &arg) == ESP32_CAM_AI_REPLY_NONE);
+        
+        snprintf(line, sizeof(line), "%sS", reply->token);
+        CHECK(esp32_cam_ai_reply_match(line, &arg) == ESP32_CAM_AI_REPLY_NONE);
+    }
+}
+
+// Strings that share hash slots with tokens still miss
+static void test_unknown_tokens(void) {
+    uint32_t state = 1;
+    char token[9];
+    
+    for(int n = 0; n < 200000; n++) {
+        state = state * 1103515245UL + 12345;
+        size_t length = 1 + (state >> 16) % 8;
+        for(size_t i = 0; i < length; i++) {
+            state = state * 1103515245UL + 12345;
+            token[i] = 'A' + (state >> 16) % 26;
+        }
+        token[length] = '\0';
+        size_t row = esp32_cam_ai_reply_find(token, length);
+        CHECK(row == row_of(token));
+    }
+}
+
+static void check_untag(const char* line, bool tagged, uint32_t id, const char* rest) {
+    bool got_tagged;
+    uint32_t got_id;
+    const char* got_rest = esp32_cam_ai_line_untag(line, &got_tagged, &got_id);
+    CHECK(got_tagged == tagged);
+    CHECK(got_id == id);
+    CHECK(strcmp(got_rest, rest) == 0);
+    if(got_tagged != tagged || got_id != id || strcmp(got_rest, rest) != 0) printf("  \"%s\"\n", line);
+}
+
+static void test_tags(void) {
+    check_untag("#3:ERROR:x", true, 3, "ERROR:x");
+    check_untag("#255:OK", true, 255, "OK");
+    check_untag("#0:OK", true, 0, "OK");
+    check_untag("OK:#3:x", false, 0, "OK:#3:x");
+    check_untag("#3ERROR:x", false, 0, "#3ERROR:x");
+    check_untag("#:OK", false, 0, "#:OK");
+    check_untag("#12", false, 0, "#12");
+    check_untag("#", false, 0, "#");
+    check_untag("#x:OK", false, 0, "#x:OK");
+    
+    // A tag is taken once; what follows is matched as is
+    check_untag("#2:#3:OK", true, 2, "#3:OK");
+    check_match("#3:OK", NULL, NULL);
+    
+    // The tagged rest routes like an untagged line
+    bool tagged;
+    uint32_t id;
+    const char* rest = esp32_cam_ai_line_untag("#3:ERROR:x", &tagged, &id);
+    check_match(rest, "ERROR", "x");
+    rest = esp32_cam_ai_line_untag("#1:CHUNK:7:OK:not final", &tagged, &id);
+    check_match(rest, "CHUNK", "7:OK:not final");
+}
+
+int main(void) {
+    esp32_cam_ai_reply_index_build();
+    test_table();
+    test_answer_text();
+    test_near_misses();
+    test_unknown_tokens();
+    test_tags();
+    return TEST_RESULT();
+}
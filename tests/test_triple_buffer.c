@@ -0,0 +1,89 @@
+// Triple buffer stress test. The producer thread fills and publishes buffers
+// as fast as it can while the consumer acquires them: every snapshot the
+// consumer reads must be whole, never older than the one before, and the
+// last acquire must see the last publish. Both sides yield now and then so
+// that the consumer gets to acquire even when the threads share one CPU.
+
+#include "esp32_cam_ai_proto.h"
+#include "test.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+
+#define WORDS (64)
+#define PUBLISHES (2000000)
+#define YIELD_EVERY (64)                // Publishes between producer yields
+#define ACQUIRED_MIN (PUBLISHES / YIELD_EVERY / 8) // Even on one CPU, about one per yield
+
+typedef struct {
+    uint32_t sequence;
+    uint32_t words[WORDS];              // sequence * 31 + i, so any mix of two fills shows
+} Snapshot;
+
+static Snapshot snapshots[3];
+static ESP32CamAITripleBuffer buffer;
+static uint32_t producer_done;
+
+static void* producer(void* context) {
+    (void)context;
+    for(uint32_t sequence = 1; sequence <= PUBLISHES; sequence++) {
+        Snapshot* snapshot = &snapshots[buffer.back];
+        snapshot->sequence = sequence;
+        for(uint32_t i = 0; i < WORDS; i++) {
+            snapshot->words[i] = sequence * 31 + i;
+        }
+        esp32_cam_ai_triple_publish(&buffer);
+        if(sequence % YIELD_EVERY == 0) sched_yield();
+    }
+    __atomic_store_n(&producer_done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static bool snapshot_whole(const Snapshot* snapshot) {
+    for(uint32_t i = 0; i < WORDS; i++) {
+        if(snapshot->words[i] != snapshot->sequence * 31 + i) return false;
+    }
+    return true;
+}
+
+int main(void) {
+    esp32_cam_ai_triple_init(&buffer);
+    for(uint32_t i = 0; i < WORDS; i++) {
+        snapshots[buffer.front].words[i] = i;
+    }
+    
+    pthread_t thread;
+    CHECK(pthread_create(&thread, NULL, producer, NULL) == 0);
+    
+    uint32_t last = 0;
+    uint32_t acquired = 0;
+    uint32_t torn = 0;
+    uint32_t stale = 0;
+    for(bool done = false; !done;) {
+        // Read the flag first: a publish that happened before it is seen below
+        done = __atomic_load_n(&producer_done, __ATOMIC_ACQUIRE);
+        bool fresh = esp32_cam_ai_triple_acquire(&buffer);
+        const Snapshot* snapshot = &snapshots[buffer.front];
+        
+        if(!snapshot_whole(snapshot)) torn++;
+        if(fresh ? snapshot->sequence <= last : snapshot->sequence != last) stale++;
+        if(fresh) acquired++;
+        last = snapshot->sequence;
+        if(!fresh) sched_yield();
+    }
+    pthread_join(thread, NULL);
+    
+    CHECK(torn == 0);
+    CHECK(stale == 0);
+    CHECK(last == PUBLISHES);
+    CHECK(acquired >= ACQUIRED_MIN);
+    CHECK(!esp32_cam_ai_triple_acquire(&buffer));
+    
+    // The three indices always stay a permutation of 0, 1, 2
+    uint32_t middle = buffer.middle & TRIPLE_BUFFER_INDEX;
+    CHECK(buffer.front != buffer.back && buffer.front != middle && buffer.back != middle);
+    
+    printf("%u publishes, %u acquired, %u torn, %u stale\n", PUBLISHES, acquired, torn, stale);
+    return TEST_RESULT();
+}